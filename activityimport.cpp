@@ -0,0 +1,613 @@
+#include "activityimport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <string_view>
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QByteArray>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include "powercurve.h"
+#include "trace.h"
+
+namespace {
+
+// Normalized Power averages the power over 30 s before the fourth power
+const int kWindow = 30;
+// A longer gap between two samples is a pause, it is not counted
+const double kMaxGap = 30;
+// Field missing from a sample
+const double kNoValue = -1;
+
+// FIT timestamps count the seconds since 1989-12-31 00:00 UTC
+const double kFitEpoch = 631065600;
+const int kFitRecord = 20;
+const int kFitDistance = 5;
+const int kFitPower = 7;
+const int kFitHeartRate = 3;
+const int kFitCadence = 4;
+const int kFitTimestamp = 253;
+
+std::string_view trimmed(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t' || text.front() == '\n' || text.front() == '\r'))
+        text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\n' || text.back() == '\r'))
+        text.remove_suffix(1);
+    return text;
+}
+
+bool parseDouble(std::string_view text, double &value) {
+    text = trimmed(text);
+    if (text.empty())
+        return false;
+#if defined(__cpp_lib_to_chars)
+    const char *first = text.data();
+    const char *last = text.data() + text.size();
+    if (*first == '+')
+        first++;
+    std::from_chars_result result = std::from_chars(first, last, value);
+    return result.ec == std::errc() && result.ptr == last;
+#else
+    bool ok = false;
+    value = QByteArray::fromRawData(text.data(), int(text.size())).toDouble(&ok);
+    return ok;
+#endif
+}
+
+bool parseDigits(std::string_view text, size_t from, size_t count, int &value) {
+    value = 0;
+    for (size_t i = from; i < from + count; i++) {
+        if (text[i] < '0' || text[i] > '9')
+            return false;
+        value = 10*value + (text[i] - '0');
+    }
+    return true;
+}
+
+// Days from 1970-01-01 to y-m-d in the proleptic Gregorian calendar
+qint64 daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    const qint64 era = (y >= 0 ? y : y - 399)/400;
+    const int yoe = y - era*400;
+    const int doy = (153*(m + (m > 2 ? -3 : 9)) + 2)/5 + d - 1;
+    const int doe = yoe*365 + yoe/4 - yoe/100 + doy;
+    return era*146097 + doe - 719468;
+}
+
+// ISO 8601 "YYYY-MM-DDTHH:MM:SS[.fff][Z|+hh:mm]", in s since epoch
+bool parseTime(std::string_view text, double &time) {
+    text = trimmed(text);
+    int year, month, day, hour, minute, second;
+    if (text.size() < 19 || !parseDigits(text, 0, 4, year) || !parseDigits(text, 5, 2, month)
+            || !parseDigits(text, 8, 2, day) || !parseDigits(text, 11, 2, hour)
+            || !parseDigits(text, 14, 2, minute) || !parseDigits(text, 17, 2, second))
+        return false;
+    time = daysFromCivil(year, month, day)*86400.0 + hour*3600 + minute*60 + second;
+    size_t i = 19;
+    if (i < text.size() && text[i] == '.') {
+        double scale = 0.1;
+        for (i++; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++, scale /= 10)
+            time += (text[i] - '0')*scale;
+    }
+    int offset_hour, offset_minute;
+    if (i + 6 <= text.size() && (text[i] == '+' || text[i] == '-')
+            && parseDigits(text, i + 1, 2, offset_hour) && parseDigits(text, i + 4, 2, offset_minute)) {
+        const double offset = offset_hour*3600 + offset_minute*60;
+        time += (text[i] == '+') ? -offset : offset;
+    }
+    return true;
+}
+
+// Great-circle distance in m
+double haversine(double lat1, double lon1, double lat2, double lon2) {
+    const double radians = 3.14159265358979323846/180;
+    const double dlat = (lat2 - lat1)*radians;
+    const double dlon = (lon2 - lon1)*radians;
+    const double a = std::sin(dlat/2)*std::sin(dlat/2)
+            + std::cos(lat1*radians)*std::cos(lat2*radians)*std::sin(dlon/2)*std::sin(dlon/2);
+    return 2*6371008.8*std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+// Folds the samples of an activity as they are read
+class ActivityAccumulator {
+public:
+    // With `samples`, the seconds are kept too
+    explicit ActivityAccumulator(ActivitySamples *samples = nullptr): mSeconds(samples) {}
+
+    // `time` in s since epoch, `distance` cumulative in m, kNoValue when a
+    // field is missing
+    void add(double time, double power, double hr, double cadence, double distance) {
+        mSamples++;
+        const double previous_distance = mDistance;
+        if (distance > mDistance)
+            mDistance = distance;
+        int seconds = 0;
+        double gap = 0;
+        if (mFirstTime < 0) {
+            mFirstTime = time;
+            if (mSeconds)
+                mSeconds->start = qint64(time);
+        } else {
+            gap = std::round(time - mLastTime);
+            if (gap <= 0)
+                return;
+            // Sparse recording: the sample stands for the seconds since the
+            // previous one, a long gap is a pause and counts for one second
+            seconds = (gap > kMaxGap) ? 1 : int(gap);
+        }
+        mLastTime = time;
+        mDuration += seconds;
+        if (power >= 0)
+            mHasPower = true;
+        for (int i = 0; i < seconds; i++)
+            addSecond(power >= 0 ? power : 0);
+        if (mSeconds && seconds > 0) {
+            const bool moving = gap <= kMaxGap && previous_distance >= 0 && distance >= previous_distance;
+            const double speed = moving ? (distance - previous_distance)/gap : 0;
+            for (int i = 0; i < seconds; i++)
+                mSeconds->append(qint32(std::lround(std::max(power, 0.0))), qint32(std::lround(std::max(hr, 0.0))),
+                                 qint32(std::lround(std::max(cadence, 0.0))), qint32(std::lround(speed*100)));
+        }
+        if (hr > 0) {
+            mHrSum += hr*seconds;
+            mHrSeconds += seconds;
+        }
+    }
+
+    void finish(const AthleteThresholds &thresholds, ActivitySummary &summary) const {
+        summary.samples = mSamples;
+        summary.ok = mSamples > 0;
+        if (!summary.ok) {
+            summary.error = "No sample";
+            return;
+        }
+        summary.date = QDateTime::fromSecsSinceEpoch(qint64(mFirstTime)).date();
+        summary.duration = mDuration;
+        summary.distance = std::max(mDistance, 0.0);
+        if (mHrSeconds > 0)
+            summary.average_hr = mHrSum/mHrSeconds;
+        if (mHasPower && mPowerSeconds > 0) {
+            summary.average_power = mPowerSum/mPowerSeconds;
+            summary.normalized_power = (mFourthCount > 0) ? std::pow(mFourthSum/mFourthCount, 0.25) : summary.average_power;
+            summary.intensity_factor = summary.normalized_power/thresholds.ftp;
+        } else if (summary.average_hr > 0) {
+            // hrTSS: the average heart rate relative to the threshold one
+            summary.intensity_factor = summary.average_hr/thresholds.threshold_hr;
+        }
+        summary.tss = mDuration/3600*summary.intensity_factor*summary.intensity_factor*100;
+    }
+
+private:
+    void addSecond(double power) {
+        // 30 s rolling mean through a ring buffer, then its fourth power
+        mRingSum += power - mRing[mRingPosition];
+        mRing[mRingPosition] = power;
+        mRingPosition = (mRingPosition + 1) % kWindow;
+        mPowerSeconds++;
+        mPowerSum += power;
+        if (mPowerSeconds >= kWindow) {
+            const double mean = mRingSum/kWindow;
+            const double square = mean*mean;
+            mFourthSum += square*square;
+            mFourthCount++;
+        }
+    }
+
+    ActivitySamples *mSeconds;
+    size_t mSamples = 0;
+    double mFirstTime = -1;
+    double mLastTime = 0;
+    double mDuration = 0;
+    double mDistance = kNoValue;
+    bool mHasPower = false;
+    double mRing[kWindow] = {};
+    double mRingSum = 0;
+    int mRingPosition = 0;
+    size_t mPowerSeconds = 0;
+    double mPowerSum = 0;
+    double mFourthSum = 0;
+    size_t mFourthCount = 0;
+    double mHrSum = 0;
+    double mHrSeconds = 0;
+};
+
+std::string_view localName(const char *begin, const char *end) {
+    const char *colon = static_cast<const char *>(std::memchr(begin, ':', end - begin));
+    return colon ? std::string_view(colon + 1, end - colon - 1) : std::string_view(begin, end - begin);
+}
+
+// Value of `name` in the attributes of a tag
+std::string_view attribute(std::string_view attributes, std::string_view name) {
+    for (size_t at = attributes.find(name); at != std::string_view::npos; at = attributes.find(name, at + 1)) {
+        const size_t quote = at + name.size() + 1;
+        if (at == 0 || attributes[at - 1] != ' ' || quote >= attributes.size() || attributes[quote - 1] != '=')
+            continue;
+        const size_t close = attributes.find(attributes[quote], quote + 1);
+        if (close != std::string_view::npos)
+            return attributes.substr(quote + 1, close - quote - 1);
+    }
+    return std::string_view();
+}
+
+// Minimal forward-only XML scanner, enough for the TCX and GPX track points:
+// the handler gets the start tags (local name and raw attributes), the text
+// between tags and the end tags. Nothing is copied.
+template<class Handler>
+void scanXml(const char *p, const char *end, Handler &handler) {
+    const char *text = p;
+    while (p < end) {
+        const char *open = static_cast<const char *>(std::memchr(p, '<', end - p));
+        if (!open)
+            return;
+        if (open > text)
+            handler.text(std::string_view(text, open - text));
+        p = open + 1;
+        if (p >= end)
+            return;
+        if (*p == '!' || *p == '?') {
+            // Declarations, comments and CDATA hold no sample
+            const char *marker = (end - p >= 3 && p[1] == '-' && p[2] == '-') ? "-->" : (*p == '!' && end - p >= 8 && std::memcmp(p, "![CDATA[", 8) == 0) ? "]]>" : ">";
+            const std::string_view rest(p, end - p);
+            const size_t close = rest.find(marker);
+            if (close == std::string_view::npos)
+                return;
+            text = p = p + close + std::strlen(marker);
+            continue;
+        }
+        const bool closing = *p == '/';
+        if (closing)
+            p++;
+        const char *close = static_cast<const char *>(std::memchr(p, '>', end - p));
+        if (!close)
+            return;
+        const char *name_end = p;
+        while (name_end < close && *name_end != ' ' && *name_end != '\t' && *name_end != '\n' && *name_end != '\r' && *name_end != '/')
+            name_end++;
+        const std::string_view name = localName(p, name_end);
+        if (closing) {
+            handler.end(name);
+        } else {
+            const bool empty = close[-1] == '/';
+            handler.start(name, std::string_view(name_end, close - name_end - (empty ? 1 : 0)));
+            if (empty)
+                handler.end(name);
+        }
+        text = p = close + 1;
+    }
+}
+
+class TrackPoint {
+public:
+    bool has_time = false;
+    double time = 0;
+    double power = kNoValue;
+    double hr = kNoValue;
+    double cadence = kNoValue;
+    double distance = kNoValue;
+    double lat = 0;
+    double lon = 0;
+    bool has_position = false;
+};
+
+// Garmin Training Center: Trackpoint/Time, DistanceMeters, HeartRateBpm/Value,
+// Cadence and the Watts of the TPX extension
+class TcxHandler {
+public:
+    explicit TcxHandler(ActivityAccumulator &accumulator): mAccumulator(accumulator) {}
+
+    void start(std::string_view name, std::string_view) {
+        if (name == "Trackpoint") {
+            mPoint = TrackPoint();
+            mInPoint = true;
+        } else if (mInPoint) {
+            if (name == "Time")
+                mField = &mPoint.time;
+            else if (name == "DistanceMeters")
+                mField = &mPoint.distance;
+            else if (name == "HeartRateBpm")
+                mInHeartRate = true;
+            else if (name == "Value" && mInHeartRate)
+                mField = &mPoint.hr;
+            else if (name == "Cadence")
+                mField = &mPoint.cadence;
+            else if (name == "Watts")
+                mField = &mPoint.power;
+        }
+    }
+    void text(std::string_view text) {
+        if (!mField)
+            return;
+        if (mField == &mPoint.time)
+            mPoint.has_time = parseTime(text, mPoint.time);
+        else if (!parseDouble(text, *mField))
+            *mField = kNoValue;
+    }
+    void end(std::string_view name) {
+        mField = nullptr;
+        if (name == "HeartRateBpm") {
+            mInHeartRate = false;
+        } else if (name == "Trackpoint") {
+            mInPoint = false;
+            if (mPoint.has_time)
+                mAccumulator.add(mPoint.time, mPoint.power, mPoint.hr, mPoint.cadence, mPoint.distance);
+        }
+    }
+
+private:
+    ActivityAccumulator &mAccumulator;
+    TrackPoint mPoint;
+    bool mInPoint = false;
+    bool mInHeartRate = false;
+    double *mField = nullptr;
+};
+
+// GPX: trkpt lat/lon, time, and the power, hr and cad extensions
+class GpxHandler {
+public:
+    explicit GpxHandler(ActivityAccumulator &accumulator): mAccumulator(accumulator) {}
+
+    void start(std::string_view name, std::string_view attributes) {
+        if (name == "trkpt") {
+            mPoint = TrackPoint();
+            mPoint.has_position = parseDouble(attribute(attributes, "lat"), mPoint.lat)
+                    && parseDouble(attribute(attributes, "lon"), mPoint.lon);
+            mInPoint = true;
+        } else if (mInPoint) {
+            if (name == "time")
+                mField = &mPoint.time;
+            else if (name == "power")
+                mField = &mPoint.power;
+            else if (name == "hr")
+                mField = &mPoint.hr;
+            else if (name == "cad")
+                mField = &mPoint.cadence;
+        }
+    }
+    void text(std::string_view text) {
+        if (!mField)
+            return;
+        if (mField == &mPoint.time)
+            mPoint.has_time = parseTime(text, mPoint.time);
+        else if (!parseDouble(text, *mField))
+            *mField = kNoValue;
+    }
+    void end(std::string_view name) {
+        mField = nullptr;
+        if (name != "trkpt")
+            return;
+        mInPoint = false;
+        if (mPoint.has_position) {
+            if (mHasPrevious)
+                mDistance += haversine(mPrevious.lat, mPrevious.lon, mPoint.lat, mPoint.lon);
+            mPrevious = mPoint;
+            mHasPrevious = true;
+        }
+        if (mPoint.has_time)
+            mAccumulator.add(mPoint.time, mPoint.power, mPoint.hr, mPoint.cadence, mDistance);
+    }
+
+private:
+    ActivityAccumulator &mAccumulator;
+    TrackPoint mPoint;
+    TrackPoint mPrevious;
+    bool mHasPrevious = false;
+    bool mInPoint = false;
+    double mDistance = 0;
+    double *mField = nullptr;
+};
+
+class FitField {
+public:
+    int number;
+    int size;
+};
+
+class FitDefinition {
+public:
+    bool defined = false;
+    bool big_endian = false;
+    int global = 0;
+    int size = 0; // bytes of a data message, developer fields included
+    std::vector<FitField> fields;
+};
+
+quint32 readFitValue(const uchar *p, int size, bool big_endian) {
+    quint32 value = 0;
+    for (int i = 0; i < size; i++)
+        value |= quint32(p[big_endian ? size - 1 - i : i]) << (8*i);
+    return value;
+}
+
+// Garmin FIT: only the record messages (timestamp, distance, power, heart
+// rate, cadence) are decoded, the others are skipped with their definition
+bool readFit(const uchar *data, const uchar *end, ActivityAccumulator &accumulator, QString &error) {
+    if (end - data < 12 || data[0] < 12 || std::memcmp(data + 8, ".FIT", 4) != 0) {
+        error = "Not a FIT file";
+        return false;
+    }
+    const int header_size = data[0];
+    if (header_size > end - data) {
+        error = "Truncated FIT header";
+        return false;
+    }
+    const quint32 data_size = readFitValue(data + 4, 4, false);
+    const uchar *p = data + header_size;
+    if (quint32(end - p) > data_size)
+        end = p + data_size;
+
+    FitDefinition definitions[16];
+    quint32 timestamp = 0;
+    while (p < end) {
+        const uchar header = *p++;
+        int local;
+        bool compressed = false;
+        if (header & 0x80) {
+            // Compressed timestamp header: 5 bits of offset on the last timestamp
+            local = (header >> 5) & 0x3;
+            const quint32 offset = header & 0x1f;
+            timestamp = (timestamp & ~quint32(0x1f)) + offset + ((offset < (timestamp & 0x1f)) ? 0x20 : 0);
+            compressed = true;
+        } else if (header & 0x40) {
+            FitDefinition &definition = definitions[header & 0xf];
+            if (end - p < 5)
+                break;
+            definition.big_endian = p[1] == 1;
+            definition.global = readFitValue(p + 2, 2, definition.big_endian);
+            const int field_count = p[4];
+            p += 5;
+            if (end - p < 3*field_count)
+                break;
+            definition.fields.clear();
+            definition.size = 0;
+            for (int i = 0; i < field_count; i++, p += 3) {
+                definition.fields.push_back(FitField{p[0], p[1]});
+                definition.size += p[1];
+            }
+            if (header & 0x20) {
+                if (p >= end)
+                    break;
+                const int developer_count = *p++;
+                if (end - p < 3*developer_count)
+                    break;
+                for (int i = 0; i < developer_count; i++, p += 3)
+                    definition.size += p[1];
+            }
+            definition.defined = true;
+            continue;
+        } else {
+            local = header & 0xf;
+        }
+
+        const FitDefinition &definition = definitions[local];
+        if (!definition.defined) {
+            error = "FIT message without definition";
+            return false;
+        }
+        if (end - p < definition.size)
+            break;
+        if (definition.global == kFitRecord) {
+            double power = kNoValue;
+            double hr = kNoValue;
+            double cadence = kNoValue;
+            double distance = kNoValue;
+            bool has_time = compressed;
+            const uchar *field = p;
+            for (const FitField &f: definition.fields) {
+                if (f.number == kFitTimestamp && f.size == 4) {
+                    timestamp = readFitValue(field, 4, definition.big_endian);
+                    has_time = true;
+                } else if (f.number == kFitDistance && f.size == 4) {
+                    const quint32 value = readFitValue(field, 4, definition.big_endian);
+                    if (value != 0xffffffff)
+                        distance = value/100.0;
+                } else if (f.number == kFitPower && f.size == 2) {
+                    const quint32 value = readFitValue(field, 2, definition.big_endian);
+                    if (value != 0xffff)
+                        power = value;
+                } else if (f.number == kFitHeartRate && f.size == 1) {
+                    if (*field != 0xff)
+                        hr = *field;
+                } else if (f.number == kFitCadence && f.size == 1) {
+                    if (*field != 0xff)
+                        cadence = *field;
+                }
+                field += f.size;
+            }
+            if (has_time)
+                accumulator.add(kFitEpoch + timestamp, power, hr, cadence, distance);
+        }
+        p += definition.size;
+    }
+    return true;
+}
+
+} // namespace
+
+ActivitySummary importActivity(const QString &filename, const AthleteThresholds &thresholds, ActivitySamples *samples)
+{
+    TRACE_SCOPE("import.activity");
+    ActivitySummary summary;
+    const QFileInfo info(filename);
+    summary.name = info.completeBaseName();
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        summary.error = "Cannot open the file";
+        return summary;
+    }
+    const qint64 size = file.size();
+    if (size == 0) {
+        summary.error = "Empty file";
+        return summary;
+    }
+    // Mapped pages are read once, in order, and never all resident
+    const uchar *data = file.map(0, size);
+    if (!data) {
+        summary.error = "Cannot map the file into memory";
+        return summary;
+    }
+
+    ActivityAccumulator accumulator(samples);
+    const QString suffix = info.suffix().toLower();
+    bool ok = true;
+    if (suffix == "fit") {
+        ok = readFit(data, data + size, accumulator, summary.error);
+    } else if (suffix == "tcx") {
+        TcxHandler handler(accumulator);
+        scanXml(reinterpret_cast<const char *>(data), reinterpret_cast<const char *>(data) + size, handler);
+    } else if (suffix == "gpx") {
+        GpxHandler handler(accumulator);
+        scanXml(reinterpret_cast<const char *>(data), reinterpret_cast<const char *>(data) + size, handler);
+    } else {
+        summary.error = "Unknown activity format";
+        ok = false;
+    }
+    file.unmap(const_cast<uchar *>(data));
+
+    if (ok)
+        accumulator.finish(thresholds, summary);
+    return summary;
+}
+
+std::vector<ActivitySummary> importActivities(const QStringList &filenames, const AthleteThresholds &thresholds, const SampleStore *store)
+{
+    std::vector<ActivitySummary> activities(filenames.size());
+    std::vector<int> indexes(filenames.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    QtConcurrent::blockingMap(indexes, [&](int index) {
+        if (!store) {
+            activities[index] = importActivity(filenames.at(index), thresholds);
+            return;
+        }
+        // The seconds only live for the time of the curve and the file
+        ActivitySamples samples;
+        ActivitySummary &activity = activities[index];
+        activity = importActivity(filenames.at(index), thresholds, &samples);
+        if (!activity.ok)
+            return;
+        activity.power_curve = meanMaximalPower(samples.columns[ActivitySamples::Power].data(), samples.size());
+        activity.sample_file = store->filename(activity.date, activity.name);
+        if (writeSampleFile(activity.sample_file, samples, activity.power_curve) != 0)
+            activity.sample_file.clear();
+    });
+    return activities;
+}
+
+void addActivity(TrainingItem &day, const ActivitySummary &activity)
+{
+    day.hour += activity.duration/3600;
+    day.Km_per_day += activity.distance/1000;
+    day.TSS += activity.tss;
+    if (day.training.size() > 0)
+        day.training.append("; ");
+    day.training.append(activity.name);
+}
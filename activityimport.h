@@ -0,0 +1,52 @@
+#ifndef ACTIVITYIMPORT_H
+#define ACTIVITYIMPORT_H
+
+#include <vector>
+
+#include <QtCore/QDate>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include "samplestore.h"
+#include "trainingitem.h"
+
+// Thresholds of the athlete, the references of IF and TSS
+class AthleteThresholds {
+public:
+    double ftp = 250;          // functional threshold power, W
+    double threshold_hr = 170; // lactate threshold heart rate, bpm
+};
+
+// What an activity file adds to a training day
+class ActivitySummary {
+public:
+    QString name;              // file name without extension
+    QDate date;                // local date of the first sample
+    bool ok = false;           // false when the file could not be read
+    QString error;
+    size_t samples = 0;
+    double duration = 0;       // s, pauses excluded
+    double distance = 0;       // m
+    double average_power = 0;  // W, 0 without power
+    double normalized_power = 0;
+    double average_hr = 0;     // bpm, 0 without heart rate
+    double intensity_factor = 0;
+    double tss = 0;            // from power when there is some, heart rate otherwise
+    std::vector<float> power_curve; // mean-maximal power, when the samples are kept
+    QString sample_file;       // empty when the samples are not stored
+};
+
+// Read a .fit, .tcx or .gpx file. The file is memory-mapped and read once
+// from start to end, samples are folded as they come: nothing but the
+// summary is kept, unless `samples` asks for the seconds.
+ActivitySummary importActivity(const QString &filename, const AthleteThresholds &thresholds, ActivitySamples *samples = nullptr);
+
+// Import files on the global thread pool, results in the order of
+// `filenames`. With a store, the samples of each activity are written to it
+// and its power curve is computed, on the same worker.
+std::vector<ActivitySummary> importActivities(const QStringList &filenames, const AthleteThresholds &thresholds, const SampleStore *store = nullptr);
+
+// Add the duration, distance and TSS of an activity to its day
+void addActivity(TrainingItem &day, const ActivitySummary &activity);
+
+#endif /* ACTIVITYIMPORT_H */
@@ -0,0 +1,20 @@
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = opencyclingtraining-bench
+
+include(../core.pri)
+
+# The calendar model is benchmarked too, it needs QtGui for its colors
+HEADERS += \
+    ../trainingtablemodel.h \
+    generator.h \
+    legacy.h \
+    report.h
+
+SOURCES += \
+    ../trainingtablemodel.cpp \
+    generator.cpp \
+    legacy.cpp \
+    main.cpp \
+    report.cpp
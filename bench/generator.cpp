@@ -0,0 +1,153 @@
+#include "generator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QtCore/QRandomGenerator>
+
+namespace {
+
+enum Session { Rest, Recovery, Endurance, Tempo, SweetSpot, VO2max, Long, Race };
+
+class SessionType {
+public:
+    const char *name;
+    double intensity;  // intensity factor
+    double min_hours;
+    double max_hours;
+};
+
+const SessionType kSessions[] = {
+    {"", 0, 0, 0},
+    {"Recovery", 0.55, 0.5, 1.0},
+    {"Endurance", 0.68, 1.5, 3.0},
+    {"Tempo", 0.80, 1.0, 2.0},
+    {"Sweet spot", 0.88, 1.0, 2.0},
+    {"VO2max", 0.95, 1.0, 1.5},
+    {"Long ride", 0.70, 3.5, 6.0},
+    {"Race", 1.00, 1.5, 4.0},
+};
+
+enum Period { Transition, Base, Build, Racing };
+
+const char *const kPeriods[] = {"Transition", "Base", "Build", "Race"};
+
+// Monday to Sunday
+const Session kWeekPlans[][7] = {
+    {Rest, Recovery, Rest, Endurance, Rest, Endurance, Rest},
+    {Rest, Endurance, Tempo, Endurance, Rest, Long, Endurance},
+    {Rest, SweetSpot, Endurance, VO2max, Recovery, Long, Tempo},
+    {Rest, VO2max, Endurance, SweetSpot, Recovery, Endurance, Race},
+};
+
+const char *const kWeathers[] = {"Clear", "Cloudy", "Rain", "Wind", "Snow"};
+
+Period periodOf(const QDate &date) {
+    const int month = date.month();
+    if (month >= 10 && month <= 11)
+        return Transition;
+    if (month == 12 || month <= 2)
+        return Base;
+    if (month <= 5)
+        return Build;
+    return Racing;
+}
+
+const char *weatherOf(const QDate &date, QRandomGenerator &rng) {
+    // Snow only in winter, more rain out of summer
+    const bool winter = date.month() == 12 || date.month() <= 2;
+    const bool summer = date.month() >= 6 && date.month() <= 8;
+    const int roll = rng.bounded(100);
+    if (roll < (summer ? 60 : 35))
+        return kWeathers[0];
+    if (roll < (summer ? 80 : 60))
+        return kWeathers[1];
+    if (roll < (summer ? 92 : 80))
+        return kWeathers[2];
+    if (!winter || roll < 90)
+        return kWeathers[3];
+    return kWeathers[4];
+}
+
+double uniform(QRandomGenerator &rng, double from, double to) {
+    return from + rng.generateDouble()*(to - from);
+}
+
+double rounded(double value, double step) {
+    return std::round(value/step)*step;
+}
+
+} // namespace
+
+std::vector<TrainingItem> generateHistory(int years, quint32 seed)
+{
+    QRandomGenerator rng(seed);
+    const QDate last(2024, 12, 31);
+    const QDate first = last.addYears(-years).addDays(1);
+    std::vector<TrainingItem> trainings;
+    trainings.reserve(first.daysTo(last) + 1);
+
+    int break_days = 0;
+    for (QDate date = first; date <= last; date = date.addDays(1)) {
+        const int season = first.daysTo(date)/365;
+        // Volume grows over the first five seasons, then stays
+        const double progression = 0.6 + 0.4*std::min(season, 5)/5.0;
+        const int week = int(first.daysTo(date)/7);
+        const double load = (week % 4 == 3) ? 0.6 : 1.0;
+        const Period period = periodOf(date);
+        const Session session = kWeekPlans[period][date.dayOfWeek() - 1];
+        const SessionType &type = kSessions[session];
+
+        TrainingItem item = blankDay();
+        item.date = date;
+        item.weather = weatherOf(date, rng);
+        item.category = kPeriods[period];
+        item.daily_objective = type.name;
+        if (session != Rest) {
+            item.hour_objective = rounded(uniform(rng, type.min_hours, type.max_hours)*progression*load, 0.25);
+            item.TSS_objective = std::round(item.hour_objective*type.intensity*type.intensity*100);
+        }
+        // Illness or holidays: one to two weeks off now and then
+        if (break_days == 0 && rng.bounded(120) == 0)
+            break_days = 3 + rng.bounded(12);
+        const bool missed = break_days > 0 || rng.bounded(100) < 8;
+        if (break_days > 0)
+            break_days--;
+
+        if (session != Rest && !missed) {
+            item.training = type.name;
+            item.hour = rounded(item.hour_objective*uniform(rng, 0.85, 1.1), 0.25);
+            const double intensity = type.intensity*uniform(rng, 0.95, 1.05);
+            item.TSS = std::round(item.hour*intensity*intensity*100);
+            item.Km_per_day = rounded(item.hour*(22 + 12*intensity + uniform(rng, -2, 2)), 0.1);
+            item.feeling = 2 + rng.bounded(4);
+        } else {
+            item.feeling = (break_days > 0) ? 1 : 3;
+        }
+        // Gym on the Mondays of the base period
+        if (period == Base && date.dayOfWeek() == 1) {
+            item.muscu_objective = "Squats, core";
+            if (break_days == 0)
+                item.muscu = item.muscu_objective;
+        }
+
+        // The week objectives sit on the Monday, from the plan of the week
+        if (date.dayOfWeek() == 1) {
+            double week_hours = 0;
+            double week_tss = 0;
+            double week_km = 0;
+            for (int day = 0; day < 7; day++) {
+                const SessionType &planned = kSessions[kWeekPlans[period][day]];
+                const double hours = (planned.min_hours + planned.max_hours)/2*progression*load;
+                week_hours += hours;
+                week_tss += hours*planned.intensity*planned.intensity*100;
+                week_km += hours*(22 + 12*planned.intensity);
+            }
+            item.hour_per_week_objective = rounded(week_hours, 0.5);
+            item.TSS_per_week_objective = std::round(week_tss);
+            item.km_per_week_objective = std::round(week_km);
+        }
+        trainings.push_back(item);
+    }
+    return trainings;
+}
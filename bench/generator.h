@@ -0,0 +1,17 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <vector>
+
+#include <QtCore/QtGlobal>
+
+#include "trainingitem.h"
+
+// A plausible training history of `years` years ending on 2024-12-31, one
+// row per day: yearly periodization (transition, base, build, race), a weekly
+// plan per period, a recovery week every four, volume growing over the first
+// seasons, missed sessions and breaks. The same seed always gives the same
+// history.
+std::vector<TrainingItem> generateHistory(int years, quint32 seed = 42);
+
+#endif /* GENERATOR_H */
@@ -0,0 +1,121 @@
+#include "legacy.h"
+
+#include <fstream>
+#include <iostream>
+
+std::vector<TrainingItem> loadTrainingsFromFileLegacy(std::string filename) {
+    std::vector<TrainingItem> database;
+    std::string line;
+    std::ifstream myfile (filename);
+
+    if (!myfile.is_open()) {
+        std::cout<<"Error: Cannot load training data from "<<filename<<std::endl;
+        return std::vector<TrainingItem>();
+    }
+
+    while (std::getline(myfile, line)) {
+        TrainingItem current_item;
+        std::string buffer;
+        bool in_apo = false;
+        int count_items = 0;
+        int count_lines = 0;
+
+        for (const char &c: line) {
+            if (c == '"') {
+                in_apo = !in_apo;
+            } else if (c == ',' && !in_apo) {
+                // save current item and start parsing next one
+                if (count_items == 0) {
+                    current_item.weather = QString::fromStdString(buffer);
+                } else if (count_items == 1) {
+                    current_item.date = QDate::fromString(QString::fromStdString(buffer));
+                } else if (count_items == 2) {
+                     current_item.training = QString::fromStdString(buffer);
+                } else if (count_items == 3) {
+                    try {
+                        current_item.hour = std::stod(buffer);
+                    } catch (...) {
+                        std::cout<<"Error: "<<buffer<<"is not a double"<<std::endl;
+                    }
+                } else if (count_items == 4) {
+                    current_item.feeling = (unsigned short int)std::stoi(buffer);
+                } else if (count_items == 5) {
+                    current_item.daily_objective = QString::fromStdString(buffer);
+                } else if (count_items == 6) {
+                    try {
+                        current_item.TSS = std::stod(buffer);
+                    } catch (...) {
+                        std::cout<<"Error: "<<buffer<<"is not a double"<<std::endl;
+                    }
+                } else if (count_items == 7) {
+                    try {
+                        current_item.Km_per_day = std::stod(buffer);
+                    } catch (...) {
+                        std::cout<<"Error: "<<buffer<<"is not a double"<<std::endl;
+                    }
+                } else if (count_items == 8) {
+                    current_item.hour_objective = std::stod(buffer);
+                } else if (count_items == 9) {
+                    current_item.TSS_objective = std::stod(buffer);
+                } else if (count_items == 10) {
+                    current_item.category = QString::fromStdString(buffer);
+                } else if (count_items == 11) {
+                    current_item.muscu = QString::fromStdString(buffer);
+                } else if (count_items == 12) {
+                    current_item.muscu_objective = QString::fromStdString(buffer);
+                } else if (count_items == 13) {
+                    current_item.km_per_week_objective = std::stod(buffer);
+                } else if (count_items == 14) {
+                    current_item.hour_per_week_objective = std::stod(buffer);
+                } else if (count_items == 15) {
+                    current_item.TSS_per_week_objective = std::stod(buffer);
+                    database.push_back(current_item);
+                } else {
+                    std::cout<<"Error: Line "<<count_lines<<"Too many items"<<std::endl;
+                }
+                count_items++;
+                buffer.clear();
+            } else {
+                buffer.push_back(c);
+            }
+        }
+        count_lines++;
+    }
+    myfile.close();
+
+    return database;
+}
+
+std::vector<LegacyWeek> weekSummaryLegacy(const std::vector<TrainingItem> &trainings)
+{
+    std::vector<LegacyWeek> mWeeks;
+    LegacyWeek tmp = LegacyWeek();
+    for (auto it = trainings.begin(); it!= trainings.end(); it++) {
+        if (tmp.year == it->date.year() && tmp.week_number == it->date.weekNumber()) {
+            tmp.sum_hour += it->hour;
+            tmp.sum_tss += it->TSS;
+            tmp.sum_km += it->Km_per_day;
+            tmp.sum_hour_objective += it->hour_objective;
+            tmp.sum_tss_objective += it->TSS_objective;
+            tmp.sum_km_objective += it->km_per_week_objective;
+            if (!it->category.isEmpty())
+                tmp.category = it->category;
+        } else {
+            if (tmp.sum_hour != 0 || tmp.sum_km != 0 || tmp.sum_tss != 0)
+                mWeeks.push_back(tmp);
+            tmp = LegacyWeek();
+            tmp.week_number = it->date.weekNumber();
+            tmp.year = it->date.year();
+            tmp.month = it->date.month();
+            tmp.sum_hour += it->hour;
+            tmp.sum_tss += it->TSS;
+            tmp.sum_km += it->Km_per_day;
+            tmp.sum_hour_objective += it->hour_objective;
+            tmp.sum_tss_objective += it->TSS_objective;
+            tmp.sum_km_objective += it->km_per_week_objective;
+            if (!it->category.isEmpty())
+                tmp.category = it->category;
+        }
+    }
+    return mWeeks;
+}
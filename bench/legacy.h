@@ -0,0 +1,33 @@
+#ifndef LEGACY_H
+#define LEGACY_H
+
+#include <string>
+#include <vector>
+
+#include "trainingitem.h"
+
+// Former implementations, kept as a baseline for the benchmarks
+
+// TrainingWeek before the compact layout, 80 bytes
+class LegacyWeek {
+public:
+    int week_number;
+    int year;
+    int month;
+    double sum_hour;
+    double sum_tss;
+    double sum_km;
+    double sum_hour_objective;
+    double sum_tss_objective;
+    double sum_km_objective;
+    QString category;
+    QString comment;
+};
+
+// getline/std::stod parser used before the memory-mapped loader
+std::vector<TrainingItem> loadTrainingsFromFileLegacy(std::string filename);
+
+// Week summary over the array of TrainingItem used before the columnar store
+std::vector<LegacyWeek> weekSummaryLegacy(const std::vector<TrainingItem> &trainings);
+
+#endif /* LEGACY_H */
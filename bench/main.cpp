@@ -0,0 +1,706 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QStringList>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+
+#include "activityimport.h"
+#include "downsample.h"
+#include "generator.h"
+#include "legacy.h"
+#include "loadmodel.h"
+#include "log.h"
+#include "powercurve.h"
+#include "report.h"
+#include "samplestore.h"
+#include "trainingfile.h"
+#include "trainingindex.h"
+#include "trainingjournal.h"
+#include "trainingloader.h"
+#include "trainingpartitions.h"
+#include "trainingplan.h"
+#include "trainingstore.h"
+#include "trainingsummary.h"
+#include "trainingtablemodel.h"
+
+namespace {
+
+// Best of `repeat` runs, in ns
+qint64 bestTime(const std::function<size_t()> &run, int repeat) {
+    qint64 best = -1;
+    size_t check = 0;
+    for (int i = 0; i < repeat; i++) {
+        QElapsedTimer timer;
+        timer.start();
+        check += run();
+        qint64 elapsed = timer.nsecsElapsed();
+        if (best < 0 || elapsed < best)
+            best = elapsed;
+    }
+    return check > 0 ? best : -1;
+}
+
+// Bytes allocated on the heap, -1 when the C library cannot tell
+qint64 heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return qint64(mallinfo2().uordblks);
+#else
+    return -1;
+#endif
+}
+
+// The TSS of every day from the first training of `store` to the last
+std::vector<double> dailyTss(const TrainingStore &store) {
+    const qint64 first = store.firstDate().toJulianDay();
+    std::vector<double> tss(size_t(store.lastDate().toJulianDay() - first + 1));
+    store.copyColumn(TrainingStore::TSS, first, tss.size(), tss.data());
+    return tss;
+}
+
+// A history and its size, what every benchmark of the GUI paths starts from
+class History {
+public:
+    History(int years): years(years), trainings(generateHistory(years)), days(int(trainings.size())) {}
+
+    int years;
+    std::vector<TrainingItem> trainings;
+    int days;
+};
+
+void benchmarkFile(BenchmarkReport &report, const History &history) {
+    const int repeat = 5;
+    QTemporaryDir dir;
+    const std::string path = QDir(dir.path()).filePath("history.csv").toStdString();
+    qint64 save = bestTime([&]() { return size_t(saveTrainingsToFile(path, history.trainings) == 0); }, repeat);
+    const double megabytes = QFileInfo(QString::fromStdString(path)).size() / 1e6;
+    qint64 legacy = bestTime([&]() { return loadTrainingsFromFileLegacy(path).size(); }, repeat);
+    qint64 mapped = bestTime([&]() {
+        TrainingRecords records;
+        loadTrainingsFromFile(path, records);
+        return records.rows.size();
+    }, repeat);
+
+    report.add("file.save", history.years, history.days, save, megabytes, "MB");
+    report.add("file.load.getline", history.years, history.days, legacy, megabytes, "MB");
+    report.add("file.load", history.years, history.days, mapped, megabytes, "MB");
+}
+
+// A file of at least `megabytes`, copies of the history one after the other,
+// parsed with 1, 2, 4... threads of the pool
+void benchmarkParallelLoad(BenchmarkReport &report, const History &history, int megabytes) {
+    const int repeat = 3;
+    QTemporaryDir dir;
+    const QString single = QDir(dir.path()).filePath("history.csv");
+    const QString path = QDir(dir.path()).filePath("large.csv");
+    if (saveTrainingsToFile(single.toStdString(), history.trainings) != 0)
+        return;
+    QFile single_file(single);
+    QFile file(path);
+    if (!single_file.open(QIODevice::ReadOnly) || !file.open(QIODevice::WriteOnly))
+        return;
+    const QByteArray copy = single_file.readAll();
+    int copies = 0;
+    while (file.size() < qint64(megabytes)*1000000) {
+        file.write(copy);
+        copies++;
+    }
+    file.close();
+    const double size = QFileInfo(path).size() / 1e6;
+
+    QThreadPool *pool = QThreadPool::globalInstance();
+    const int threads = pool->maxThreadCount();
+    for (int count = 1; ; count = std::min(2*count, QThread::idealThreadCount())) {
+        pool->setMaxThreadCount(count);
+        qint64 time = bestTime([&]() {
+            TrainingRecords records;
+            loadTrainingsFromFile(path.toStdString(), records);
+            return records.rows.size();
+        }, repeat);
+        report.add(QString("file.load.parallel.%1t").arg(count), history.years*copies, history.days*copies, time, size, "MB");
+        if (count >= QThread::idealThreadCount())
+            break;
+    }
+    pool->setMaxThreadCount(threads);
+}
+
+// Heap held by the loaded rows: one string per row and field with the legacy
+// loader, compact records and interned strings with loadTrainingsFromFile()
+void benchmarkMemory(BenchmarkReport &report, const History &history) {
+    QTemporaryDir dir;
+    const std::string path = QDir(dir.path()).filePath("history.csv").toStdString();
+    if (saveTrainingsToFile(path, history.trainings) != 0)
+        return;
+    auto held = [](const std::function<void()> &load) {
+        const qint64 before = heapInUse();
+        load();
+        return before < 0 ? -1 : heapInUse() - before;
+    };
+    std::vector<TrainingItem> legacy;
+    TrainingRecords records;
+    TrainingStore store;
+    const qint64 legacy_bytes = held([&]() { legacy = loadTrainingsFromFileLegacy(path); });
+    const qint64 records_bytes = held([&]() { loadTrainingsFromFile(path, records); });
+    const qint64 store_bytes = held([&]() { store.assign(records); });
+
+    report.addMemory("memory.load.getline", history.years, history.days, legacy_bytes);
+    report.addMemory("memory.load", history.years, history.days, records_bytes);
+    report.addMemory("memory.store", history.years, history.days, store_bytes);
+}
+
+// What the GUI reads before showing the current week: the whole history or
+// the season of that week through the year index, then a season paged in
+void benchmarkPartitions(BenchmarkReport &report, const History &history) {
+    const int repeat = 5;
+    QTemporaryDir dir;
+    const std::string path = QDir(dir.path()).filePath("history.csv").toStdString();
+    if (saveTrainingsToFile(path, history.trainings) != 0)
+        return;
+    TrainingJournal journal(path);
+    const QDate last = history.trainings.back().date;
+    const QDate monday = last.addDays(1 - last.dayOfWeek());
+    const QDate first = history.trainings.front().date;
+
+    qint64 full = bestTime([&]() { return loadTrainings(journal)->trainings.size(); }, repeat);
+    qint64 window = bestTime([&]() { return loadTrainings(journal, monday, monday.addDays(6))->trainings.size(); }, repeat);
+    qint64 page_in = bestTime([&]() {
+        TrainingStore trainings;
+        TrainingPartitions partitions;
+        partitions.ensure(journal, trainings, first, first);
+        return trainings.size();
+    }, repeat);
+
+    auto held = [](const std::function<QSharedPointer<LoadedTrainings>()> &load) {
+        const qint64 before = heapInUse();
+        QSharedPointer<LoadedTrainings> loaded = load();
+        return before < 0 ? -1 : heapInUse() - before;
+    };
+    const qint64 full_bytes = held([&]() { return loadTrainings(journal); });
+    const qint64 window_bytes = held([&]() { return loadTrainings(journal, monday, monday.addDays(6)); });
+
+    report.add("startup.full", history.years, history.days, full);
+    report.add("startup.window", history.years, history.days, window);
+    report.add("partitions.page_in", history.years, history.days, page_in);
+    report.addMemory("memory.startup.full", history.years, history.days, full_bytes);
+    report.addMemory("memory.startup.window", history.years, history.days, window_bytes);
+}
+
+// What the GUI does before the current week is painted: open the backend,
+// read the season of the week, index it and show the week table and totals.
+// False when the best run goes over `budget_ms`.
+bool benchmarkFirstPaint(BenchmarkReport &report, const History &history, qint64 budget_ms) {
+    const int repeat = 5;
+    QTemporaryDir dir;
+    const std::string path = QDir(dir.path()).filePath("history.csv").toStdString();
+    if (saveTrainingsToFile(path, history.trainings) != 0)
+        return false;
+    const QDate last = history.trainings.back().date;
+    const QDate monday = last.addDays(1 - last.dayOfWeek());
+
+    qint64 first_paint = bestTime([&]() {
+        std::unique_ptr<TrainingBackend> backend = openTrainingBackend(path);
+        QSharedPointer<LoadedTrainings> loaded = loadTrainings(*backend, monday, monday.addDays(6));
+        TrainingTableModel model(loaded->trainings);
+        model.setDateRange(monday, monday.addDays(6));
+        size_t cells = 0;
+        for (int row = 0; row < model.rowCount(); row++) {
+            for (int column = 0; column < model.columnCount(); column++)
+                cells += model.data(model.index(row, column), Qt::DisplayRole).isValid();
+        }
+        const TrainingWeek week = rangeSummary(loaded->index, monday, monday.addDays(6));
+        return cells + size_t(week.sum_tss >= 0);
+    }, repeat);
+    report.add("startup.first_paint", history.years, history.days, first_paint);
+    if (first_paint > budget_ms*1000000) {
+        std::cout<<"Error: first paint of a "<<history.years<<" years history takes "<<first_paint/1000000
+                 <<" ms, over the "<<budget_ms<<" ms budget"<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Weeks, fatigue and fitness of the whole history: derived from every row,
+// read back from the cache, and with one year edited since the cache
+void benchmarkDerivedCache(BenchmarkReport &report, const History &history) {
+    const int repeat = 5;
+    QTemporaryDir dir;
+    const std::string path = QDir(dir.path()).filePath("history.csv").toStdString();
+    if (saveTrainingsToFile(path, history.trainings) != 0)
+        return;
+    TrainingJournal journal(path);
+    const QString cache = QString::fromStdString(path + ".derived");
+
+    qint64 cold = bestTime([&]() {
+        QFile::remove(cache);
+        return deriveSeries(journal)->weeks.size();
+    }, repeat);
+    qint64 warm = bestTime([&]() { return deriveSeries(journal)->weeks.size(); }, repeat);
+    // Each run edits the same day again: its year is the only one to derive
+    TrainingItem edit = history.trainings[history.trainings.size()/2];
+    qint64 one_year = bestTime([&]() {
+        edit.TSS += 1;
+        journal.save(edit);
+        return deriveSeries(journal)->weeks.size();
+    }, repeat);
+
+    report.add("derive.cold", history.years, history.days, cold);
+    report.add("derive.warm", history.years, history.days, warm);
+    report.add("derive.one_year", history.years, history.days, one_year);
+}
+
+void reportSizes(BenchmarkReport &report) {
+    report.addMemory("sizeof.TrainingItem", 0, 0, sizeof(TrainingItem));
+    report.addMemory("sizeof.TrainingRecord", 0, 0, sizeof(TrainingRecord));
+    report.addMemory("sizeof.LegacyWeek", 0, 0, sizeof(LegacyWeek));
+    report.addMemory("sizeof.TrainingWeek", 0, 0, sizeof(TrainingWeek));
+}
+
+// The compact records against TrainingItem and the former week layout:
+// sizes, sort by date and copy of a whole history
+void benchmarkRecords(BenchmarkReport &report, const History &history) {
+    const int repeat = 10;
+    std::vector<TrainingItem> items = history.trainings;
+    std::shuffle(items.begin(), items.end(), QRandomGenerator(5));
+    TrainingRecords records;
+    for (const TrainingItem &item: items)
+        records.append(item);
+    qint64 item_sort = bestTime([&]() {
+        std::vector<TrainingItem> sorted = items;
+        std::sort(sorted.begin(), sorted.end(), [](const TrainingItem &a, const TrainingItem &b) { return a.date < b.date; });
+        return sorted.size();
+    }, repeat);
+    qint64 record_sort = bestTime([&]() {
+        std::vector<TrainingRecord> sorted = records.rows;
+        std::sort(sorted.begin(), sorted.end(), [](const TrainingRecord &a, const TrainingRecord &b) { return a.day < b.day; });
+        return sorted.size();
+    }, repeat);
+    qint64 item_copy = bestTime([&]() { std::vector<TrainingItem> copy = items; return copy.size(); }, repeat);
+    qint64 record_copy = bestTime([&]() { std::vector<TrainingRecord> copy = records.rows; return copy.size(); }, repeat);
+
+    TrainingStore store;
+    store.assign(records);
+    TrainingIndex index;
+    index.build(store);
+    const std::vector<LegacyWeek> legacy_weeks = weekSummaryLegacy(history.trainings);
+    const std::vector<TrainingWeek> weeks = weekSummary(store, index);
+    qint64 legacy_week_copy = bestTime([&]() { std::vector<LegacyWeek> copy = legacy_weeks; return copy.size(); }, repeat);
+    qint64 week_copy = bestTime([&]() { std::vector<TrainingWeek> copy = weeks; return copy.size(); }, repeat);
+
+    report.add("items.sort", history.years, history.days, item_sort, history.days, "rows");
+    report.add("records.sort", history.years, history.days, record_sort, history.days, "rows");
+    report.add("items.copy", history.years, history.days, item_copy, history.days, "rows");
+    report.add("records.copy", history.years, history.days, record_copy, history.days, "rows");
+    report.add("weeks.copy.legacy", history.years, history.days, legacy_week_copy, weeks.size(), "weeks");
+    report.add("weeks.copy", history.years, history.days, week_copy, weeks.size(), "weeks");
+}
+
+void benchmarkStore(BenchmarkReport &report, const History &history) {
+    const int repeat = 20;
+    // Rows in any order, assign() sorts them (it replaced orderVector)
+    std::vector<TrainingItem> shuffled = history.trainings;
+    std::shuffle(shuffled.begin(), shuffled.end(), QRandomGenerator(5));
+    TrainingRecords records;
+    for (const TrainingItem &item: shuffled)
+        records.append(item);
+    TrainingStore store;
+    qint64 assign = bestTime([&]() { store.assign(records); return store.size(); }, repeat);
+    TrainingItem day = history.trainings[history.days/2];
+    qint64 insert = bestTime([&]() {
+        day.TSS += 1;
+        store.insert(day);
+        return store.size();
+    }, repeat);
+
+    report.add("store.assign", history.years, history.days, assign, history.days, "rows");
+    report.add("store.insert", history.years, history.days, insert);
+}
+
+void benchmarkWeekSummary(BenchmarkReport &report, const History &history) {
+    const int repeat = 20;
+    TrainingStore store;
+    store.assign(history.trainings);
+    TrainingIndex index;
+
+    qint64 legacy = bestTime([&]() { return weekSummaryLegacy(history.trainings).size(); }, repeat);
+    qint64 build = bestTime([&]() { index.build(store); return store.slotCount(); }, repeat);
+    std::vector<TrainingWeek> weeks;
+    qint64 full = bestTime([&]() { weeks = weekSummary(store, index); return weeks.size(); }, repeat);
+    const QDate edited = store.firstDate().addDays(history.days/2);
+    TrainingItem day = store.value(edited);
+    qint64 edit = bestTime([&]() {
+        day.TSS += 1;
+        store.insert(day);
+        index.update(store, edited);
+        updateWeekSummary(weeks, store, index, edited);
+        return weeks.size();
+    }, repeat);
+
+    const int queries = 10000;
+    const QDate first = store.firstDate();
+    qint64 range = bestTime([&]() {
+        double total = 0;
+        for (int i = 0; i < queries; i++) {
+            const QDate from = first.addDays((i*37) % history.days);
+            total += rangeSummary(index, from, from.addDays((i*101) % 365)).sum_km;
+        }
+        return size_t(total > 0);
+    }, repeat);
+
+    report.add("weeks.legacy", history.years, history.days, legacy, history.days, "days");
+    report.add("index.build", history.years, history.days, build, history.days, "days");
+    report.add("weeks.full", history.years, history.days, full, history.days, "days");
+    report.add("weeks.day_edit", history.years, history.days, edit);
+    report.add("range.query", history.years, history.days, range, queries, "queries");
+}
+
+void benchmarkLoadModel(BenchmarkReport &report, const History &history) {
+    const int repeat = 20;
+    TrainingStore store;
+    store.assign(history.trainings);
+    const std::vector<double> tss = dailyTss(store);
+    const qint64 first_day = store.firstDate().toJulianDay();
+    const qint64 edited_day = first_day + qint64(tss.size()/2);
+    LoadSeries fatigue(fatigue_coef, std::size(fatigue_coef));
+    LoadSeries fitness(fitness_coef, std::size(fitness_coef), fitness_coef_factor);
+
+    for (LoadSeries *series: {&fatigue, &fitness}) {
+        qint64 full = bestTime([&]() {
+            series->compute(tss.data(), tss.size(), first_day);
+            return series->size();
+        }, repeat);
+        qint64 update = bestTime([&]() {
+            series->update(tss.data(), tss.size(), first_day, edited_day);
+            return series->size();
+        }, repeat);
+        const QString name = (series == &fatigue) ? "fatigue" : "fitness";
+        report.add(name + ".full", history.years, history.days, full, history.days, "days");
+        report.add(name + ".day_edit", history.years, history.days, update);
+    }
+}
+
+// A 12 weeks build to a race from the end of the history, and the projection
+// of the plan found
+void benchmarkPlanSearch(BenchmarkReport &report, const History &history) {
+    const int repeat = 5;
+    TrainingStore store;
+    store.assign(history.trainings);
+    const std::vector<double> tss = dailyTss(store);
+    const qint64 first_day = store.firstDate().toJulianDay();
+    PlanGoal goal;
+    goal.start = first_day + qint64(tss.size());
+    goal.race_day = goal.start + 84;
+    goal.target_form = 10;
+    goal.max_week_tss = 600;
+
+    std::vector<PlanCandidate> candidates;
+    qint64 search = bestTime([&]() {
+        candidates = searchPlans(tss.data(), tss.size(), first_day, goal);
+        return candidates.size();
+    }, repeat);
+    const std::vector<double> plan = candidates.empty() ? std::vector<double>(84, 0.0) : candidates.front().tss;
+    qint64 project = bestTime([&]() {
+        return projectPlan(tss.data(), tss.size(), first_day, goal.start, plan).size();
+    }, repeat);
+    report.add("plan.search", history.years, history.days, search);
+    report.add("plan.project", history.years, history.days, project, plan.size(), "days");
+}
+
+// The calendar table: a reset of the model, then the cells of one screen as
+// the view reads them, and the signal of a one day edit
+void benchmarkCalendar(BenchmarkReport &report, const History &history) {
+    const int repeat = 20;
+    const int visible_rows = 40;
+    TrainingStore store;
+    store.assign(history.trainings);
+    TrainingTableModel model(store);
+
+    qint64 reload = bestTime([&]() {
+        model.reload();
+        size_t cells = 0;
+        for (int row = std::max(model.rowCount() - visible_rows, 0); row < model.rowCount(); row++) {
+            for (int column = 0; column < model.columnCount(); column++) {
+                const QModelIndex cell = model.index(row, column);
+                cells += model.data(cell, Qt::DisplayRole).isValid();
+                cells += model.data(cell, Qt::BackgroundRole).isValid();
+            }
+        }
+        return cells;
+    }, repeat);
+    TrainingItem day = history.trainings[history.days/2];
+    qint64 edit = bestTime([&]() {
+        day.TSS += 1;
+        store.insert(day);
+        return size_t(model.dayChanged(day.date));
+    }, repeat);
+
+    report.add("calendar.reload", history.years, history.days, reload);
+    report.add("calendar.day_edit", history.years, history.days, edit);
+}
+
+// What the charts get on each refresh: the points of the week and load
+// series, then their LTTB sampling to the width of the plot
+void benchmarkChart(BenchmarkReport &report, const History &history) {
+    const int repeat = 20;
+    const size_t width = 1000;
+    TrainingStore store;
+    store.assign(history.trainings);
+    TrainingIndex index;
+    index.build(store);
+    const std::vector<TrainingWeek> weeks = weekSummary(store, index);
+    LoadSeries fatigue(fatigue_coef, std::size(fatigue_coef));
+    LoadSeries fitness(fitness_coef, std::size(fitness_coef), fitness_coef_factor);
+    const std::vector<double> tss = dailyTss(store);
+    fatigue.compute(tss.data(), tss.size(), store.firstDate().toJulianDay());
+    fitness.compute(tss.data(), tss.size(), store.firstDate().toJulianDay());
+    FormSeries form(fitness, fatigue);
+
+    std::vector<std::vector<QPointF>> series(6);
+    qint64 points = bestTime([&]() {
+        for (std::vector<QPointF> &points: series)
+            points.clear();
+        for (const TrainingWeek &week: weeks) {
+            const double x = weekStart(week).startOfDay().toMSecsSinceEpoch();
+            series[0].emplace_back(x, week.sum_km);
+            series[1].emplace_back(x, week.sum_tss);
+            series[2].emplace_back(x, week.sum_hour);
+        }
+        form.invalidateAll();
+        const qint64 first = fitness.firstDay();
+        const std::vector<double> values = form.range(first, first + fitness.size() - 1);
+        const double origin = QDate::fromJulianDay(first).startOfDay().toMSecsSinceEpoch();
+        for (size_t i = 0; i < fitness.size(); i++) {
+            const double x = origin + i*86400000.0;
+            series[3].emplace_back(x, fatigue.at(first + i));
+            series[4].emplace_back(x, fitness.at(first + i));
+            series[5].emplace_back(x, values[i]);
+        }
+        return series[5].size();
+    }, repeat);
+    qint64 lttb = bestTime([&]() {
+        size_t count = 0;
+        for (const std::vector<QPointF> &points: series)
+            count += downsampleLttb(points.data(), points.size(), width).size();
+        return count;
+    }, repeat);
+
+    report.add("chart.points", history.years, history.days, points);
+    report.add("chart.lttb", history.years, history.days, lttb);
+}
+
+// A ride of `seconds` at 1 Hz, as written by a Garmin head unit
+QByteArray syntheticTcx(int seconds) {
+    QRandomGenerator rng(7);
+    const QDateTime start(QDate(2020, 6, 1), QTime(9, 0), Qt::UTC);
+    QByteArray tcx = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<TrainingCenterDatabase xmlns:ns3=\"http://www.garmin.com/xmlschemas/ActivityExtension/v2\">"
+            "<Activities><Activity Sport=\"Biking\"><Lap><Track>\n";
+    for (int i = 0; i < seconds; i++) {
+        tcx += "<Trackpoint><Time>" + start.addSecs(i).toString(Qt::ISODate).toUtf8() + "</Time>"
+                "<DistanceMeters>" + QByteArray::number(i*8.5) + "</DistanceMeters>"
+                "<HeartRateBpm><Value>" + QByteArray::number(120 + rng.bounded(40)) + "</Value></HeartRateBpm>"
+                "<Extensions><ns3:TPX><ns3:Watts>" + QByteArray::number(150 + rng.bounded(200)) + "</ns3:Watts></ns3:TPX></Extensions>"
+                "</Trackpoint>\n";
+    }
+    tcx += "</Track></Lap></Activity></Activities></TrainingCenterDatabase>\n";
+    return tcx;
+}
+
+// The same ride as FIT record messages (timestamp, distance, power, heart rate)
+QByteArray syntheticFit(int seconds) {
+    QRandomGenerator rng(7);
+    QByteArray data;
+    auto put = [&data](quint32 value, int size) {
+        for (int i = 0; i < size; i++)
+            data += char((value >> (8*i)) & 0xff);
+    };
+    // Definition of local message 0: global message 20 (record), 4 fields
+    put(0x40, 1); put(0, 1); put(0, 1); put(20, 2); put(4, 1);
+    put(253, 1); put(4, 1); put(0x86, 1);
+    put(5, 1); put(4, 1); put(0x86, 1);
+    put(7, 1); put(2, 1); put(0x84, 1);
+    put(3, 1); put(1, 1); put(0x02, 1);
+    const quint32 start = QDateTime(QDate(2020, 6, 1), QTime(9, 0), Qt::UTC).toSecsSinceEpoch() - 631065600;
+    for (int i = 0; i < seconds; i++) {
+        put(0, 1);
+        put(start + i, 4);
+        put(i*850, 4);
+        put(150 + rng.bounded(200), 2);
+        put(120 + rng.bounded(40), 1);
+    }
+    QByteArray fit;
+    const int size = data.size();
+    fit += char(14); fit += char(0x10); fit += char(2093 & 0xff); fit += char(2093 >> 8);
+    for (int i = 0; i < 4; i++)
+        fit += char((size >> (8*i)) & 0xff);
+    fit += ".FIT";
+    fit += QByteArray(2, 0);
+    fit += data;
+    fit += QByteArray(2, 0);
+    return fit;
+}
+
+void benchmarkActivityImport(BenchmarkReport &report, int files) {
+    const int repeat = 10;
+    const int seconds = 4*3600;
+    QTemporaryDir dir;
+    const QString tcx = QDir(dir.path()).filePath("ride.tcx");
+    const QString fit = QDir(dir.path()).filePath("ride.fit");
+    QFile tcx_file(tcx);
+    QFile fit_file(fit);
+    if (!tcx_file.open(QIODevice::WriteOnly) || !fit_file.open(QIODevice::WriteOnly))
+        return;
+    tcx_file.write(syntheticTcx(seconds));
+    fit_file.write(syntheticFit(seconds));
+    tcx_file.close();
+    fit_file.close();
+
+    const AthleteThresholds thresholds;
+    qint64 tcx_time = bestTime([&]() { return importActivity(tcx, thresholds).samples; }, repeat);
+    qint64 fit_time = bestTime([&]() { return importActivity(fit, thresholds).samples; }, repeat);
+
+    QStringList bulk;
+    for (int i = 0; i < files; i++) {
+        const QString copy = QDir(dir.path()).filePath(QString("ride%1.fit").arg(i));
+        QFile::copy(fit, copy);
+        bulk << copy;
+    }
+    qint64 bulk_time = bestTime([&]() { return importActivities(bulk, thresholds).size(); }, 1);
+
+    // 4 h at 1 Hz
+    report.add("import.tcx", 0, 0, tcx_time, seconds, "samples");
+    report.add("import.fit", 0, 0, fit_time, seconds, "samples");
+    report.add("import.fit_parallel", 0, 0, bulk_time, files, "files");
+}
+
+// Prefix sums without SIMD, the reference of the curve
+std::vector<float> meanMaximalPowerScalar(const std::vector<qint32> &power) {
+    std::vector<double> prefix(power.size() + 1, 0.0);
+    for (size_t i = 0; i < power.size(); i++)
+        prefix[i + 1] = prefix[i] + power[i];
+    std::vector<float> curve(power.size());
+    for (size_t duration = 1; duration <= power.size(); duration++) {
+        double best = 0;
+        for (size_t i = 0; i + duration <= power.size(); i++)
+            best = std::max(best, prefix[i + duration] - prefix[i]);
+        curve[duration - 1] = float(best/duration);
+    }
+    return curve;
+}
+
+void benchmarkPowerCurve(BenchmarkReport &report, int seconds) {
+    const int repeat = 5;
+    QRandomGenerator rng(11);
+    ActivitySamples samples;
+    for (int i = 0; i < seconds; i++)
+        samples.append(150 + rng.bounded(200), 120 + rng.bounded(40), 85 + rng.bounded(10), 800 + rng.bounded(300));
+    const std::vector<qint32> &power = samples.columns[ActivitySamples::Power];
+
+    std::vector<float> curve;
+    qint64 scalar_time = bestTime([&]() { return meanMaximalPowerScalar(power).size(); }, repeat);
+    qint64 simd_time = bestTime([&]() { curve = meanMaximalPower(power.data(), power.size()); return curve.size(); }, repeat);
+
+    // Adding an activity to the season bests
+    SeasonBests bests;
+    qint64 season_time = bestTime([&]() { bests.add(2020, curve); return bests.curve(2020).size(); }, repeat);
+
+    QTemporaryDir dir;
+    const QString filename = QDir(dir.path()).filePath("ride.samples");
+    writeSampleFile(filename, samples, curve);
+    SampleFile file;
+    qint64 read_time = bestTime([&]() { file.open(filename); return file.column(ActivitySamples::Power).size(); }, repeat);
+
+    report.add("power_curve.scalar", 0, 0, scalar_time, seconds, "samples");
+    report.add("power_curve", 0, 0, simd_time, seconds, "samples");
+    report.add("power_curve.season_add", 0, 0, season_time);
+    report.add("samples.read_column", 0, 0, read_time, QFileInfo(filename).size()/1e6, "MB");
+}
+
+// Cost of a debug message left in a hot loop of a release run
+void benchmarkLog(BenchmarkReport &report, int count) {
+    const qint64 filtered_time = bestTime([&]() {
+        for (int i = 0; i < count; i++)
+            LOG_DEBUG("Day "<<i<<" load "<<i*0.5);
+        return size_t(count);
+    }, 5);
+    report.add("log.filtered", 0, 0, filtered_time, count, "calls");
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("opencyclingtraining-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks of the training file, summaries, load model, calendar and charts on generated histories.");
+    parser.addHelpOption();
+    QCommandLineOption years_option(QStringList()<<"y"<<"years", "Comma separated lengths of the histories, in years (1 to 50).", "list", "1,10,50");
+    QCommandLineOption json_option(QStringList()<<"o"<<"json", "Write the results to a JSON file.", "file");
+    QCommandLineOption first_paint_option("first-paint-budget", "Fail when the startup to the first paint of the current week takes longer.", "ms", "200");
+    parser.addOption(years_option);
+    parser.addOption(json_option);
+    parser.addOption(first_paint_option);
+    parser.process(app);
+    // The report owns stdout, the core only warns
+    setLogLevel(LogLevel::Warning);
+
+    std::vector<int> years;
+    for (const QString &value: parser.value(years_option).split(',')) {
+        const int count = value.toInt();
+        if (count < 1 || count > 50) {
+            std::cout<<"Error: history length "<<value.toStdString()<<" out of 1 to 50 years"<<std::endl;
+            return 1;
+        }
+        years.push_back(count);
+    }
+
+    const qint64 first_paint_budget = parser.value(first_paint_option).toLongLong();
+
+    BenchmarkReport report;
+    reportSizes(report);
+    bool within_budget = true;
+    for (int count: years) {
+        const History history(count);
+        within_budget = benchmarkFirstPaint(report, history, first_paint_budget) && within_budget;
+        benchmarkFile(report, history);
+        benchmarkMemory(report, history);
+        benchmarkRecords(report, history);
+        benchmarkStore(report, history);
+        benchmarkPartitions(report, history);
+        benchmarkDerivedCache(report, history);
+        benchmarkWeekSummary(report, history);
+        benchmarkLoadModel(report, history);
+        benchmarkPlanSearch(report, history);
+        benchmarkCalendar(report, history);
+        benchmarkChart(report, history);
+    }
+    benchmarkParallelLoad(report, History(50), 100);
+    benchmarkActivityImport(report, 500);
+    benchmarkPowerCurve(report, 4*3600);
+    benchmarkLog(report, 1000000);
+
+    if (parser.isSet(json_option) && report.writeJson(parser.value(json_option)) != 0)
+        return 1;
+    return within_budget ? 0 : 1;
+}
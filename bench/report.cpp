@@ -0,0 +1,77 @@
+#include "report.h"
+
+#include <iomanip>
+#include <iostream>
+
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QSaveFile>
+
+void BenchmarkReport::add(const QString &name, int years, int days, qint64 ns, double items, const QString &unit)
+{
+    QJsonObject result;
+    result["name"] = name;
+    result["years"] = years;
+    result["days"] = days;
+    result["ns"] = double(ns);
+    if (items > 0) {
+        result["items"] = items;
+        result["unit"] = unit;
+    }
+    mResults.append(result);
+
+    std::cout<<std::left<<std::setw(28)<<name.toStdString()<<std::right;
+    if (years > 0)
+        std::cout<<std::setw(3)<<years<<" y ";
+    else
+        std::cout<<"      ";
+    if (ns < 0) {
+        std::cout<<"failed"<<std::endl;
+        return;
+    }
+    if (ns >= 10000000)
+        std::cout<<std::setw(10)<<ns/1e6<<" ms";
+    else
+        std::cout<<std::setw(10)<<ns/1e3<<" us";
+    if (ns > 0 && items > 0)
+        std::cout<<"  "<<items/(ns/1e9)<<" "<<unit.toStdString()<<"/s";
+    std::cout<<std::endl;
+}
+
+void BenchmarkReport::addMemory(const QString &name, int years, int days, qint64 bytes)
+{
+    QJsonObject result;
+    result["name"] = name;
+    result["years"] = years;
+    result["days"] = days;
+    result["bytes"] = double(bytes);
+    mResults.append(result);
+
+    std::cout<<std::left<<std::setw(28)<<name.toStdString()<<std::right;
+    if (years > 0)
+        std::cout<<std::setw(3)<<years<<" y ";
+    else
+        std::cout<<"      ";
+    if (bytes < 0)
+        std::cout<<"unavailable"<<std::endl;
+    else if (bytes < 10240)
+        std::cout<<std::setw(10)<<bytes<<" B"<<std::endl;
+    else
+        std::cout<<std::setw(10)<<bytes/1024.0<<" KB"<<std::endl;
+}
+
+int BenchmarkReport::writeJson(const QString &filename) const
+{
+    QJsonObject report;
+    report["qt"] = QString(qVersion());
+    report["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["results"] = mResults;
+
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(report).toJson()) < 0 || !file.commit()) {
+        std::cout<<"Error: Cannot write the results to "<<filename.toStdString()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
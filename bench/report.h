@@ -0,0 +1,25 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QString>
+
+// Results of a run, printed as they come and saved as JSON so that two
+// versions can be compared:
+// {"qt": ..., "date": ..., "results": [{"name", "years", "days", "ns", "items", "unit"}]}
+// Memory results have "bytes" instead of "ns".
+class BenchmarkReport {
+public:
+    // `ns` is the best run; `items` processed by it (rows, MB...) gives a
+    // rate when there are some. `years` and `days` are 0 for the benchmarks
+    // that do not depend on the history.
+    void add(const QString &name, int years, int days, qint64 ns, double items = 0, const QString &unit = QString());
+    // Heap held by a structure, negative when it cannot be measured
+    void addMemory(const QString &name, int years, int days, qint64 bytes);
+    int writeJson(const QString &filename) const;
+
+private:
+    QJsonArray mResults;
+};
+
+#endif /* REPORT_H */
@@ -0,0 +1,10 @@
+QT -= gui
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = opencyclingtraining-batch
+
+include(../core.pri)
+
+SOURCES += \
+    main.cpp
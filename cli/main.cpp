@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutex>
+#include <QtCore/QSaveFile>
+#include <QtCore/QThreadPool>
+
+#include "trainingbackend.h"
+#include "trainingloader.h"
+#include "trainingsummary.h"
+
+// Batch processing of a squad: one training CSV per athlete in a directory,
+// a weekly summary and the load curves written for each of them.
+
+namespace {
+
+class Athlete {
+public:
+    QString input;
+    QString name;
+    qint64 size;
+};
+
+class BatchResult {
+public:
+    std::atomic<size_t> files{0};
+    std::atomic<size_t> days{0};
+    std::atomic<size_t> failures{0};
+    QMutex mutex; // serializes the messages of the workers
+};
+
+int writeFile(const QString &filename, const std::string &content)
+{
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly) || file.write(content.data(), content.size()) != qint64(content.size()) || !file.commit()) {
+        std::cout<<"Error: cannot write "<<filename.toStdString()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+std::string weekReport(const std::vector<TrainingWeek> &weeks, const StringPool &strings)
+{
+    std::ostringstream out;
+    out<<"year,week,monday,km,hours,tss,km_objective,hours_objective,tss_objective,category\n";
+    for (const TrainingWeek &week: weeks) {
+        out<<week.year<<','<<int(week.week_number)<<','<<weekStart(week).toString(Qt::ISODate).toStdString()<<','
+           <<week.sum_km<<','<<week.sum_hour<<','<<week.sum_tss<<','
+           <<week.sum_km_objective<<','<<week.sum_hour_objective<<','<<week.sum_tss_objective<<','
+           <<strings.text(week.category).toStdString()<<'\n';
+    }
+    return out.str();
+}
+
+std::string loadReport(const TrainingStore &trainings, const DerivedSeries &derived)
+{
+    std::ostringstream out;
+    out<<"date,tss,atl,ctl,tsb\n";
+    // The fitness series is the longest, it goes on after the last training
+    const qint64 first = derived.fitness.firstDay();
+    for (size_t i = 0; i < derived.fitness.size(); i++) {
+        const qint64 day = first + i;
+        const double atl = derived.fatigue.at(day);
+        const double ctl = derived.fitness.at(day);
+        out<<QDate::fromJulianDay(day).toString(Qt::ISODate).toStdString()<<','
+           <<trainings.dayValue(TrainingStore::TSS, day)<<','<<atl<<','<<ctl<<','<<ctl - atl<<'\n';
+    }
+    return out.str();
+}
+
+void processAthlete(const Athlete &athlete, const QString &output_path, BatchResult &result)
+{
+    // QDir is not thread-safe, each job has its own
+    const QDir output(output_path);
+    std::unique_ptr<TrainingBackend> backend = openTrainingBackend(athlete.input.toStdString());
+    QSharedPointer<LoadedTrainings> loaded = loadTrainings(*backend);
+    QSharedPointer<DerivedSeries> derived = deriveSeries(loaded->trainings, loaded->index);
+
+    int failed = writeFile(output.filePath(athlete.name + ".weeks.csv"), weekReport(derived->weeks, loaded->trainings.strings()));
+    failed |= writeFile(output.filePath(athlete.name + ".load.csv"), loadReport(loaded->trainings, *derived));
+
+    result.files++;
+    result.days += loaded->trainings.slotCount();
+    if (failed)
+        result.failures++;
+    if (!loaded->errors.empty()) {
+        QMutexLocker locker(&result.mutex);
+        for (const TrainingFileError &error: loaded->errors)
+            std::cout<<athlete.input.toStdString()<<":"<<error.line<<": "<<error.message<<std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("opencyclingtraining-batch");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Weekly summaries and load curves (ATL, CTL, TSB) of every training file in a directory.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "Directory holding one training CSV (or migrated .db) per athlete.");
+    parser.addPositionalArgument("output", "Directory receiving <athlete>.weeks.csv and <athlete>.load.csv.");
+    QCommandLineOption jobs(QStringList()<<"j"<<"jobs", "Number of worker threads (all the cores by default).", "count");
+    parser.addOption(jobs);
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.size() != 2)
+        parser.showHelp(1);
+    if (parser.isSet(jobs))
+        QThreadPool::globalInstance()->setMaxThreadCount(std::max(parser.value(jobs).toInt(), 1));
+
+    const QDir input(arguments.at(0));
+    const QDir output(arguments.at(1));
+    if (!input.exists()) {
+        std::cout<<"Error: no directory "<<arguments.at(0).toStdString()<<std::endl;
+        return 1;
+    }
+    if (!output.mkpath(".")) {
+        std::cout<<"Error: cannot create "<<arguments.at(1).toStdString()<<std::endl;
+        return 1;
+    }
+
+    std::vector<Athlete> athletes;
+    for (const QFileInfo &info: input.entryInfoList(QStringList()<<"*.csv"<<"*.db", QDir::Files))
+        athletes.push_back(Athlete{info.absoluteFilePath(), info.completeBaseName(), info.size()});
+    // Biggest files first: the long jobs start early and the small ones fill
+    // the gaps at the end instead of leaving a single thread working
+    std::sort(athletes.begin(), athletes.end(), [](const Athlete &a, const Athlete &b) {
+        return a.size > b.size;
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    BatchResult result;
+    const QString output_path = output.absolutePath();
+    // Each worker takes the next file as soon as it is done with one
+    QtConcurrent::blockingMap(athletes, [&](const Athlete &athlete) {
+        processAthlete(athlete, output_path, result);
+    });
+
+    std::cout<<result.files<<" athletes, "<<result.days<<" days in "<<timer.elapsed()<<" ms on "
+             <<QThreadPool::globalInstance()->maxThreadCount()<<" threads"<<std::endl;
+    return result.failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,52 @@
+QT += concurrent sql
+CONFIG += c++17
+
+INCLUDEPATH += $$PWD
+
+# Debug messages only exist in debug builds
+CONFIG(release, debug|release): DEFINES += OPENCYCLINGTRAINING_LOG_LEVEL=1
+
+HEADERS += \
+    $$PWD/activityimport.h \
+    $$PWD/derivedcache.h \
+    $$PWD/downsample.h \
+    $$PWD/loadmodel.h \
+    $$PWD/log.h \
+    $$PWD/powercurve.h \
+    $$PWD/samplestore.h \
+    $$PWD/simd.h \
+    $$PWD/sqlitebackend.h \
+    $$PWD/stringpool.h \
+    $$PWD/trace.h \
+    $$PWD/trainingbackend.h \
+    $$PWD/trainingfile.h \
+    $$PWD/trainingindex.h \
+    $$PWD/trainingitem.h \
+    $$PWD/trainingjournal.h \
+    $$PWD/trainingloader.h \
+    $$PWD/trainingpartitions.h \
+    $$PWD/trainingplan.h \
+    $$PWD/trainingstore.h \
+    $$PWD/trainingsummary.h
+
+SOURCES += \
+    $$PWD/activityimport.cpp \
+    $$PWD/derivedcache.cpp \
+    $$PWD/downsample.cpp \
+    $$PWD/loadmodel.cpp \
+    $$PWD/log.cpp \
+    $$PWD/powercurve.cpp \
+    $$PWD/samplestore.cpp \
+    $$PWD/sqlitebackend.cpp \
+    $$PWD/stringpool.cpp \
+    $$PWD/trace.cpp \
+    $$PWD/trainingbackend.cpp \
+    $$PWD/trainingfile.cpp \
+    $$PWD/trainingindex.cpp \
+    $$PWD/trainingitem.cpp \
+    $$PWD/trainingjournal.cpp \
+    $$PWD/trainingloader.cpp \
+    $$PWD/trainingpartitions.cpp \
+    $$PWD/trainingplan.cpp \
+    $$PWD/trainingstore.cpp \
+    $$PWD/trainingsummary.cpp
@@ -0,0 +1,207 @@
+#include "derivedcache.h"
+
+#include <cstring>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+
+#include "log.h"
+#include "trace.h"
+
+namespace {
+
+const char kMagic[4] = {'O', 'C', 'T', 'D'};
+const int kVersion = 1;
+// magic, version, year count, week count, string count, TSS count, first
+// day, fatigue size, fitness size
+const int kHeaderSize = 4 + 2 + 2 + 4 + 4 + 4 + 8 + 4 + 4;
+const int kYearSize = 4 + 8 + 8 + 8;
+const int kWeekSize = 32;
+
+void appendValue(QByteArray &data, quint64 value, int size) {
+    for (int i = 0; i < size; i++)
+        data.append(char((value >> (8*i)) & 0xff));
+}
+
+quint64 readValue(const uchar *p, int size) {
+    quint64 value = 0;
+    for (int i = 0; i < size; i++)
+        value |= quint64(p[i]) << (8*i);
+    return value;
+}
+
+void appendFloat(QByteArray &data, float value) {
+    quint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    appendValue(data, bits, 4);
+}
+
+float readFloat(const uchar *p) {
+    const quint32 bits = quint32(readValue(p, 4));
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void appendDoubles(QByteArray &data, const double *values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        quint64 bits;
+        std::memcpy(&bits, &values[i], sizeof(bits));
+        appendValue(data, bits, 8);
+    }
+}
+
+std::vector<double> readDoubles(const uchar *p, size_t count) {
+    std::vector<double> values(count);
+    for (size_t i = 0; i < count; i++) {
+        const quint64 bits = readValue(p + 8*i, 8);
+        std::memcpy(&values[i], &bits, sizeof(bits));
+    }
+    return values;
+}
+
+QString cacheName(const std::string &filename) {
+    return QString::fromStdString(filename + ".derived");
+}
+
+// The content of a mapped cache, false when it does not hold together
+bool parseCache(const uchar *data, qint64 size, DerivedSeries &derived, std::vector<DerivedYear> &years) {
+    if (size < kHeaderSize || std::memcmp(data, kMagic, 4) != 0 || readValue(data + 4, 2) != kVersion)
+        return false;
+    const size_t year_count = readValue(data + 6, 2);
+    const size_t week_count = readValue(data + 8, 4);
+    const size_t string_count = readValue(data + 12, 4);
+    const size_t tss_count = readValue(data + 16, 4);
+    const qint64 first_day = qint64(readValue(data + 20, 8));
+    const size_t fatigue_size = readValue(data + 28, 4);
+    const size_t fitness_size = readValue(data + 32, 4);
+    // Load series cover `taps` days after the last TSS
+    auto seriesSize = [tss_count](const LoadSeries &series) {
+        return tss_count > 0 ? tss_count + series.taps() : 0;
+    };
+    if (fatigue_size != seriesSize(derived.fatigue) || fitness_size != seriesSize(derived.fitness))
+        return false;
+    const qint64 fixed = kHeaderSize + kYearSize*qint64(year_count) + 8*qint64(tss_count + fatigue_size + fitness_size)
+            + kWeekSize*qint64(week_count);
+    if (size < fixed)
+        return false;
+
+    const uchar *p = data + kHeaderSize;
+    years.clear();
+    for (size_t i = 0; i < year_count; i++, p += kYearSize)
+        years.push_back(DerivedYear{qint32(readValue(p, 4)), readValue(p + 4, 8), qint64(readValue(p + 12, 8)), qint64(readValue(p + 20, 8))});
+    derived.tss = readDoubles(p, tss_count);
+    p += 8*tss_count;
+    derived.first_day = first_day;
+    derived.fatigue.assign(readDoubles(p, fatigue_size), tss_count, first_day);
+    p += 8*fatigue_size;
+    derived.fitness.assign(readDoubles(p, fitness_size), tss_count, first_day);
+    p += 8*fitness_size;
+
+    derived.weeks.resize(week_count);
+    for (TrainingWeek &week: derived.weeks) {
+        week.year = qint16(readValue(p, 2));
+        week.week_number = quint8(p[2]);
+        week.month = quint8(p[3]);
+        week.sum_hour = readFloat(p + 4);
+        week.sum_tss = readFloat(p + 8);
+        week.sum_km = readFloat(p + 12);
+        week.sum_hour_objective = readFloat(p + 16);
+        week.sum_tss_objective = readFloat(p + 20);
+        week.sum_km_objective = readFloat(p + 24);
+        week.category = quint32(readValue(p + 28, 4));
+        if (week.category > string_count)
+            return false;
+        p += kWeekSize;
+    }
+
+    // Interned in code order, they get their codes back
+    const uchar *end = data + size;
+    derived.strings.clear();
+    for (quint32 code = 1; code <= string_count; code++) {
+        if (end - p < 4)
+            return false;
+        const size_t length = readValue(p, 4);
+        if (size_t(end - p - 4) < length)
+            return false;
+        const QString text = QString::fromUtf8(reinterpret_cast<const char *>(p + 4), int(length));
+        if (derived.strings.intern(text) != code)
+            return false;
+        p += 4 + length;
+    }
+    return p == end;
+}
+
+} // namespace
+
+bool readDerivedCache(const std::string &filename, DerivedSeries &derived, std::vector<DerivedYear> &years)
+{
+    TRACE_SCOPE("derived_cache.read");
+    QFile file(cacheName(filename));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    const qint64 size = file.size();
+    const uchar *data = size > 0 ? file.map(0, size) : nullptr;
+    if (!data)
+        return false;
+    const bool valid = parseCache(data, size, derived, years);
+    file.unmap(const_cast<uchar *>(data));
+    if (!valid)
+        LOG_WARNING("Ignoring the damaged cache "<<cacheName(filename).toStdString());
+    return valid;
+}
+
+int writeDerivedCache(const std::string &filename, const DerivedSeries &derived, const std::vector<DerivedYear> &years)
+{
+    TRACE_SCOPE("derived_cache.write");
+    const size_t tss_count = derived.tss.size();
+    const size_t fatigue_size = tss_count > 0 ? derived.fatigue.size() : 0;
+    const size_t fitness_size = tss_count > 0 ? derived.fitness.size() : 0;
+    QByteArray data;
+    data.reserve(int(kHeaderSize + kYearSize*years.size() + 8*(tss_count + fatigue_size + fitness_size)
+                     + kWeekSize*derived.weeks.size()));
+    data.append(kMagic, 4);
+    appendValue(data, kVersion, 2);
+    appendValue(data, years.size(), 2);
+    appendValue(data, derived.weeks.size(), 4);
+    appendValue(data, derived.strings.size() - 1, 4);
+    appendValue(data, tss_count, 4);
+    appendValue(data, quint64(derived.first_day), 8);
+    appendValue(data, fatigue_size, 4);
+    appendValue(data, fitness_size, 4);
+    for (const DerivedYear &year: years) {
+        appendValue(data, quint32(year.year), 4);
+        appendValue(data, year.hash, 8);
+        appendValue(data, quint64(year.first_day), 8);
+        appendValue(data, quint64(year.last_day), 8);
+    }
+    appendDoubles(data, derived.tss.data(), tss_count);
+    appendDoubles(data, derived.fatigue.values(), fatigue_size);
+    appendDoubles(data, derived.fitness.values(), fitness_size);
+    for (const TrainingWeek &week: derived.weeks) {
+        appendValue(data, quint16(week.year), 2);
+        appendValue(data, week.week_number, 1);
+        appendValue(data, week.month, 1);
+        appendFloat(data, week.sum_hour);
+        appendFloat(data, week.sum_tss);
+        appendFloat(data, week.sum_km);
+        appendFloat(data, week.sum_hour_objective);
+        appendFloat(data, week.sum_tss_objective);
+        appendFloat(data, week.sum_km_objective);
+        appendValue(data, week.category, 4);
+    }
+    for (quint32 code = 1; code < derived.strings.size(); code++) {
+        const QByteArray text = derived.strings.text(code).toUtf8();
+        appendValue(data, quint32(text.size()), 4);
+        data.append(text);
+    }
+
+    // Only an optimization: a failure just means deriving again next time
+    QSaveFile file(cacheName(filename));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        LOG_WARNING("Cannot write the cache "<<cacheName(filename).toStdString());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef DERIVEDCACHE_H
+#define DERIVEDCACHE_H
+
+#include <string>
+#include <vector>
+
+#include "trainingloader.h"
+
+// A year of the backend as the cache knows it: the content hash it was
+// derived from and its first and last days with a training (last_day <
+// first_day when there is none)
+class DerivedYear {
+public:
+    qint32 year;
+    quint64 hash;
+    qint64 first_day;
+    qint64 last_day;
+};
+
+// The series derived from the whole history (weeks and their categories,
+// TSS per day, fatigue, fitness) saved as "<filename>.derived" next to the
+// training file, with the years they come from. The file is memory-mapped
+// and its arrays read back as they are; deriveSeries() only derives again
+// the years whose hash changed.
+//
+// Little-endian: magic, version, year, week, string and TSS counts, first
+// day, fatigue and fitness sizes, then the years, the TSS, fatigue and
+// fitness values (doubles), the weeks (32 bytes each) and the strings
+// (length, UTF-8) from code 1 on.
+bool readDerivedCache(const std::string &filename, DerivedSeries &derived, std::vector<DerivedYear> &years);
+int writeDerivedCache(const std::string &filename, const DerivedSeries &derived, const std::vector<DerivedYear> &years);
+
+#endif /* DERIVEDCACHE_H */
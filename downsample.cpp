@@ -0,0 +1,59 @@
+#include "downsample.h"
+
+#include <algorithm>
+#include <cmath>
+
+QVector<QPointF> downsampleLttb(const QPointF *points, size_t count, size_t threshold)
+{
+    QVector<QPointF> sampled;
+    if (threshold >= count || threshold < 3) {
+        sampled.reserve(int(count));
+        for (size_t i = 0; i < count; i++)
+            sampled.append(points[i]);
+        return sampled;
+    }
+
+    sampled.reserve(int(threshold));
+    sampled.append(points[0]);
+    // The first and last points have their own buckets
+    const double bucket_size = double(count - 2)/(threshold - 2);
+    size_t previous = 0;
+    for (size_t bucket = 0; bucket < threshold - 2; bucket++) {
+        // Average of the next bucket, the third corner of the triangle
+        const size_t next_begin = size_t((bucket + 1)*bucket_size) + 1;
+        const size_t next_end = std::min(size_t((bucket + 2)*bucket_size) + 1, count);
+        double average_x = 0;
+        double average_y = 0;
+        for (size_t i = next_begin; i < next_end; i++) {
+            average_x += points[i].x();
+            average_y += points[i].y();
+        }
+        if (next_end > next_begin) {
+            average_x /= next_end - next_begin;
+            average_y /= next_end - next_begin;
+        } else {
+            average_x = points[count - 1].x();
+            average_y = points[count - 1].y();
+        }
+
+        // Point of this bucket making the largest triangle with the one kept
+        // before and the average of the next bucket
+        const size_t begin = size_t(bucket*bucket_size) + 1;
+        const size_t end = std::min(size_t((bucket + 1)*bucket_size) + 1, count - 1);
+        const QPointF &a = points[previous];
+        double max_area = -1;
+        size_t selected = begin;
+        for (size_t i = begin; i < end; i++) {
+            const double area = std::fabs((a.x() - average_x)*(points[i].y() - a.y())
+                                          - (a.x() - points[i].x())*(average_y - a.y()));
+            if (area > max_area) {
+                max_area = area;
+                selected = i;
+            }
+        }
+        sampled.append(points[selected]);
+        previous = selected;
+    }
+    sampled.append(points[count - 1]);
+    return sampled;
+}
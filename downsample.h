@@ -0,0 +1,15 @@
+#ifndef DOWNSAMPLE_H
+#define DOWNSAMPLE_H
+
+#include <cstddef>
+
+#include <QtCore/QPointF>
+#include <QtCore/QVector>
+
+// Largest-Triangle-Three-Buckets: keep `threshold` of the `count` points
+// (sorted by x) that best preserve the shape of the curve. The first and the
+// last points are always kept, peaks and troughs survive the reduction.
+// Returns the points unchanged when there are no more than `threshold`.
+QVector<QPointF> downsampleLttb(const QPointF *points, size_t count, size_t threshold);
+
+#endif /* DOWNSAMPLE_H */
@@ -0,0 +1,218 @@
+#include "loadmodel.h"
+
+#include <algorithm>
+
+#include "simd.h"
+#include "trace.h"
+
+const double fatigue_coef[7] = {0.06, 0.07, 0.09, 0.14, 0.19, 0.22, 0.23};
+
+const double fitness_coef_factor = 1.4;
+const double fitness_coef[39] = {0.007,0.008,0.009,0.01,0.011,0.012,0.013,0.014,0.015,0.016,0.017,0.018,0.019,0.02,0.021,0.022,0.023,0.025,0.026,0.027,0.028,0.03,0.0315,0.032,0.032,0.033,0.034,0.035,0.036,0.037,0.037,0.037,0.036,0.035,0.034,0.0335,0.033,0.032,0.031};
+
+namespace {
+
+// y[i] += a*x[i]
+void axpyScalar(double a, const double *x, double *y, size_t n, size_t i = 0)
+{
+    for (; i < n; i++)
+        y[i] += a*x[i];
+}
+
+#if defined(SIMD_AVX)
+__attribute__((target("avx")))
+void axpyAvx(double a, const double *x, double *y, size_t n)
+{
+    size_t i = 0;
+    const __m256d va = _mm256_set1_pd(a);
+    for (; i + 8 <= n; i += 8) {
+        __m256d y0 = _mm256_loadu_pd(y + i);
+        __m256d y1 = _mm256_loadu_pd(y + i + 4);
+        y0 = _mm256_add_pd(y0, _mm256_mul_pd(va, _mm256_loadu_pd(x + i)));
+        y1 = _mm256_add_pd(y1, _mm256_mul_pd(va, _mm256_loadu_pd(x + i + 4)));
+        _mm256_storeu_pd(y + i, y0);
+        _mm256_storeu_pd(y + i + 4, y1);
+    }
+    axpyScalar(a, x, y, n, i);
+}
+#endif
+
+} // namespace
+
+void multiplyAdd(double a, const double *x, double *y, size_t n)
+{
+#if defined(SIMD_AVX)
+    if (hasAvx()) {
+        axpyAvx(a, x, y, n);
+        return;
+    }
+#endif
+    size_t i = 0;
+#if defined(SIMD_SSE2)
+    const __m128d va = _mm_set1_pd(a);
+    for (; i + 4 <= n; i += 4) {
+        __m128d y0 = _mm_loadu_pd(y + i);
+        __m128d y1 = _mm_loadu_pd(y + i + 2);
+        y0 = _mm_add_pd(y0, _mm_mul_pd(va, _mm_loadu_pd(x + i)));
+        y1 = _mm_add_pd(y1, _mm_mul_pd(va, _mm_loadu_pd(x + i + 2)));
+        _mm_storeu_pd(y + i, y0);
+        _mm_storeu_pd(y + i + 2, y1);
+    }
+#endif
+    axpyScalar(a, x, y, n, i);
+}
+
+void convolveLoad(const double *kernel, size_t taps, const double *in, size_t count, double *out, size_t from, size_t to)
+{
+    if (from >= to)
+        return;
+    std::fill(out + from, out + to, 0.0);
+    // One tap at a time over the whole range: the inner loop is a plain
+    // contiguous multiply-add
+    for (size_t k = 0; k < taps; k++) {
+        // in[i-1-k] exists for k+1 <= i < count+k+1
+        const size_t begin = std::max(from, k + 1);
+        const size_t end = std::min(to, count + k + 1);
+        if (begin < end)
+            multiplyAdd(kernel[k], in + begin - 1 - k, out + begin, end - begin);
+    }
+}
+
+LoadSeries::LoadSeries(const double *coef, size_t taps, double factor):
+    mKernel(coef, coef + taps),
+    mFirstDay(0),
+    mCount(0)
+{
+    for (double &value: mKernel)
+        value *= factor;
+}
+
+void LoadSeries::compute(const double *tss, size_t count, qint64 first_day)
+{
+    TRACE_SCOPE("load.compute");
+    mFirstDay = first_day;
+    mCount = count;
+    mValues.assign(count > 0 ? count + taps() : 0, 0.0);
+    convolveLoad(mKernel.data(), taps(), tss, count, mValues.data(), 0, mValues.size());
+}
+
+void LoadSeries::assign(std::vector<double> values, size_t count, qint64 first_day)
+{
+    mFirstDay = first_day;
+    mCount = count;
+    mValues = std::move(values);
+}
+
+void LoadSeries::update(const double *tss, size_t count, qint64 first_day, qint64 day)
+{
+    update(tss, count, first_day, day, day);
+}
+
+size_t LoadSeries::update(const double *tss, size_t count, qint64 first_day, qint64 from, qint64 to)
+{
+    TRACE_SCOPE("load.update");
+    // Days added before the first one: the whole series moves
+    if (first_day != mFirstDay || count < mCount || mCount == 0) {
+        compute(tss, count, first_day);
+        return mValues.size();
+    }
+    size_t computed = 0;
+    if (count > mCount) {
+        // Days added after the last one, only their successors change
+        const size_t begin = mCount + 1;
+        mCount = count;
+        mValues.resize(count + taps(), 0.0);
+        convolveLoad(mKernel.data(), taps(), tss, count, mValues.data(), begin, mValues.size());
+        computed += mValues.size() - begin;
+    }
+    from = std::max(from, first_day);
+    to = std::min(to, first_day + qint64(count) - 1);
+    if (from > to)
+        return computed;
+    const size_t begin = from - first_day + 1;
+    const size_t end = std::min(size_t(to - first_day) + 1 + taps(), mValues.size());
+    convolveLoad(mKernel.data(), taps(), tss, count, mValues.data(), begin, end);
+    return computed + end - begin;
+}
+
+double LoadSeries::at(qint64 day) const
+{
+    if (day < mFirstDay || day >= mFirstDay + qint64(mValues.size()))
+        return 0;
+    return mValues[day - mFirstDay];
+}
+
+FormSeries::FormSeries(const LoadSeries &fitness, const LoadSeries &fatigue):
+    mFitness(fitness),
+    mFatigue(fatigue),
+    mFirstDay(0)
+{
+}
+
+void FormSeries::invalidateAll()
+{
+    mValues.clear();
+    mDirty.clear();
+    reshape();
+}
+
+void FormSeries::invalidate(qint64 from, qint64 to)
+{
+    reshape();
+    from = std::max(from, mFirstDay);
+    to = std::min(to, mFirstDay + qint64(mValues.size()) - 1);
+    if (from > to)
+        return;
+    for (size_t block = (from - mFirstDay)/kBlockSize; block <= size_t(to - mFirstDay)/kBlockSize; block++)
+        mDirty[block] = 1;
+}
+
+double FormSeries::at(qint64 day)
+{
+    reshape();
+    if (day < mFirstDay || day >= mFirstDay + qint64(mValues.size()))
+        return mFitness.at(day) - mFatigue.at(day);
+    const size_t index = day - mFirstDay;
+    if (mDirty[index/kBlockSize])
+        refreshBlock(index/kBlockSize);
+    return mValues[index];
+}
+
+std::vector<double> FormSeries::range(qint64 from, qint64 to)
+{
+    std::vector<double> values;
+    if (from > to)
+        return values;
+    values.reserve(to - from + 1);
+    for (qint64 day = from; day <= to; day++)
+        values.push_back(at(day));
+    return values;
+}
+
+void FormSeries::reshape()
+{
+    // The series follow the fitness one, which is the longest
+    const qint64 first_day = mFitness.firstDay();
+    const size_t size = mFitness.size();
+    if (first_day == mFirstDay && size == mValues.size())
+        return;
+    if (first_day != mFirstDay || size < mValues.size()) {
+        mValues.clear();
+        mDirty.clear();
+    }
+    // Days added at the end: the last block and the new ones are stale
+    if (!mDirty.empty())
+        mDirty.back() = 1;
+    mFirstDay = first_day;
+    mValues.resize(size, 0.0);
+    mDirty.resize((size + kBlockSize - 1)/kBlockSize, 1);
+}
+
+void FormSeries::refreshBlock(size_t block)
+{
+    const size_t begin = block*kBlockSize;
+    const size_t end = std::min(begin + kBlockSize, mValues.size());
+    for (size_t index = begin; index < end; index++)
+        mValues[index] = mFitness.at(mFirstDay + index) - mFatigue.at(mFirstDay + index);
+    mDirty[block] = 0;
+}
@@ -0,0 +1,88 @@
+#ifndef LOADMODEL_H
+#define LOADMODEL_H
+
+#include <cstddef>
+#include <vector>
+
+#include <QtCore/QtGlobal>
+
+extern const double fatigue_coef[7];
+
+extern const double fitness_coef_factor;
+extern const double fitness_coef[39];
+
+// y[i] += a*x[i] for i in [0, n), with SSE2 or AVX when available
+void multiplyAdd(double a, const double *x, double *y, size_t n);
+
+// out[i] = sum(kernel[k]*in[i-1-k]) for i in [from, to), `in` holds `count`
+// values and is 0 outside of them.
+void convolveLoad(const double *kernel, size_t taps, const double *in, size_t count, double *out, size_t from, size_t to);
+
+// Training load of each day as a weighted sum of the TSS of the previous days
+// (fatigue/ATL, fitness/CTL).
+//
+// The input is a TSS value per calendar day, rest days included (0), so the
+// series follows the calendar and not the list of trainings. Values are kept
+// for `taps` days after the last training, the load is 0 afterwards.
+class LoadSeries {
+public:
+    LoadSeries(const double *coef, size_t taps, double factor = 1.0);
+
+    // Recompute everything, tss[0] is Julian day `first_day`
+    void compute(const double *tss, size_t count, qint64 first_day);
+    // Only the TSS of Julian day `day` changed since the last call: refresh
+    // the `taps` days after it
+    void update(const double *tss, size_t count, qint64 first_day, qint64 day);
+    // Only the TSS of Julian days [from, to] changed: refresh the days from
+    // `from`+1 to `to`+taps, returns how many values were recomputed
+    size_t update(const double *tss, size_t count, qint64 first_day, qint64 from, qint64 to);
+    // Values computed earlier from `count` TSS values starting at Julian day
+    // `first_day` (read back from a cache), `count` + taps() of them
+    void assign(std::vector<double> values, size_t count, qint64 first_day);
+
+    size_t taps() const { return mKernel.size(); }
+    qint64 firstDay() const { return mFirstDay; }
+    size_t size() const { return mValues.size(); }
+    const double *values() const { return mValues.data(); }
+    double at(qint64 day) const;
+
+private:
+    std::vector<double> mKernel;
+    std::vector<double> mValues;
+    qint64 mFirstDay;
+    size_t mCount;
+};
+
+// Form (TSB): fitness - fatigue, computed on demand.
+//
+// Values are cached by blocks of days. A block is only computed when a day in
+// it is asked for, and invalidate() just flags the blocks touched by an edit,
+// so a query never recomputes more than the blocks it reads.
+class FormSeries {
+public:
+    FormSeries(const LoadSeries &fitness, const LoadSeries &fatigue);
+
+    // The load series were recomputed from scratch
+    void invalidateAll();
+    // Julian days [from, to] of the load series changed
+    void invalidate(qint64 from, qint64 to);
+
+    // Form of Julian day `day`, O(1) once its block is computed
+    double at(qint64 day);
+    // Form of each day in [from, to]
+    std::vector<double> range(qint64 from, qint64 to);
+
+private:
+    static const size_t kBlockSize = 64;
+
+    void reshape();
+    void refreshBlock(size_t block);
+
+    const LoadSeries &mFitness;
+    const LoadSeries &mFatigue;
+    qint64 mFirstDay;
+    std::vector<double> mValues;
+    std::vector<unsigned char> mDirty; // one flag per block
+};
+
+#endif /* LOADMODEL_H */
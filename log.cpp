@@ -0,0 +1,168 @@
+#include "log.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <QtCore/QtGlobal>
+
+std::atomic<int> gLogLevel(int(LogLevel::Info));
+
+namespace {
+
+// Multiple producers, single consumer, without lock (Vyukov): producers swap
+// the head, the writer follows the next pointers from the tail. The tail is
+// always a node already consumed.
+class LogQueue {
+public:
+    LogQueue(): mHead(new Node), mTail(mHead.load()) {}
+    ~LogQueue() {
+        while (mTail) {
+            Node *next = mTail->next.load();
+            delete mTail;
+            mTail = next;
+        }
+    }
+
+    void push(LogLevel level, std::string text) {
+        Node *node = new Node;
+        node->level = level;
+        node->text = std::move(text);
+        Node *previous = mHead.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // Writer thread only
+    bool pop(LogLevel &level, std::string &text) {
+        Node *next = mTail->next.load(std::memory_order_acquire);
+        if (!next)
+            return false;
+        level = next->level;
+        text = std::move(next->text);
+        delete mTail;
+        mTail = next;
+        return true;
+    }
+
+private:
+    class Node {
+    public:
+        std::atomic<Node *> next{nullptr};
+        LogLevel level = LogLevel::Info;
+        std::string text;
+    };
+
+    std::atomic<Node *> mHead;
+    Node *mTail;
+};
+
+const char *prefix(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug:
+        return "Debug: ";
+    case LogLevel::Warning:
+        return "Warning: ";
+    case LogLevel::Error:
+        return "Error: ";
+    default:
+        return "";
+    }
+}
+
+class Logger {
+public:
+    Logger(): mQueued(0), mWritten(0), mWaiting(false), mStop(false), mThread(&Logger::run, this) {}
+    ~Logger() {
+        mStop.store(true);
+        mWakeUp.notify_one();
+        mThread.join();
+    }
+
+    void push(LogLevel level, std::string text) {
+        mQueue.push(level, std::move(text));
+        mQueued.fetch_add(1, std::memory_order_release);
+        // The writer sleeps at most 50 ms, a missed notification only delays it
+        if (mWaiting.load(std::memory_order_relaxed))
+            mWakeUp.notify_one();
+    }
+
+    void flush() {
+        const quint64 queued = mQueued.load(std::memory_order_acquire);
+        while (mWritten.load(std::memory_order_acquire) < queued) {
+            mWakeUp.notify_one();
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    void run() {
+        LogLevel level;
+        std::string text;
+        for (;;) {
+            // One flush of the console per batch
+            quint64 written = 0;
+            while (mQueue.pop(level, text)) {
+                std::cout<<prefix(level)<<text<<'\n';
+                written++;
+            }
+            if (written > 0) {
+                std::cout.flush();
+                mWritten.fetch_add(written, std::memory_order_release);
+                continue;
+            }
+            if (mStop.load())
+                return;
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWaiting.store(true);
+            mWakeUp.wait_for(lock, std::chrono::milliseconds(50));
+            mWaiting.store(false);
+        }
+    }
+
+    LogQueue mQueue;
+    std::atomic<quint64> mQueued;
+    std::atomic<quint64> mWritten;
+    std::atomic<bool> mWaiting;
+    std::atomic<bool> mStop;
+    std::mutex mMutex;
+    std::condition_variable mWakeUp;
+    std::thread mThread;
+};
+
+Logger &logger() {
+    // Started with the first message, drained when the program exits
+    static Logger instance;
+    return instance;
+}
+
+} // namespace
+
+void setLogLevel(LogLevel level)
+{
+    gLogLevel.store(int(level), std::memory_order_relaxed);
+}
+
+LogLevel logLevelFromName(const std::string &name)
+{
+    if (name == "debug")
+        return LogLevel::Debug;
+    if (name == "warning")
+        return LogLevel::Warning;
+    if (name == "error")
+        return LogLevel::Error;
+    if (name == "off")
+        return LogLevel::Off;
+    return LogLevel::Info;
+}
+
+void logMessage(LogLevel level, std::string text)
+{
+    logger().push(level, std::move(text));
+}
+
+void flushLog()
+{
+    logger().flush();
+}
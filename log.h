@@ -0,0 +1,55 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <sstream>
+#include <string>
+
+// Leveled logging through a background writer.
+//
+// LOG_INFO("Loaded "<<count<<" days") only evaluates and formats its
+// arguments when the level is enabled; the line is then queued (lock-free)
+// and written to stdout by a dedicated thread, so the caller never waits on
+// the console. Levels below OPENCYCLINGTRAINING_LOG_LEVEL are compiled out,
+// the others are filtered at run time by setLogLevel().
+
+enum class LogLevel {
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+#ifndef OPENCYCLINGTRAINING_LOG_LEVEL
+#define OPENCYCLINGTRAINING_LOG_LEVEL 0
+#endif
+
+extern std::atomic<int> gLogLevel;
+
+inline bool logEnabled(LogLevel level) { return int(level) >= gLogLevel.load(std::memory_order_relaxed); }
+void setLogLevel(LogLevel level);
+// "debug", "info", "warning", "error" or "off", Info otherwise
+LogLevel logLevelFromName(const std::string &name);
+
+// Queue a formatted line
+void logMessage(LogLevel level, std::string text);
+// Wait until every queued line is written
+void flushLog();
+
+// Variadic so that commas of template arguments pass through
+#define LOG_AT(level, ...) \
+    do { \
+        if (int(level) >= OPENCYCLINGTRAINING_LOG_LEVEL && logEnabled(level)) { \
+            std::ostringstream log_stream_; \
+            log_stream_<<__VA_ARGS__; \
+            logMessage(level, log_stream_.str()); \
+        } \
+    } while (false)
+
+#define LOG_DEBUG(...) LOG_AT(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LogLevel::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogLevel::Error, __VA_ARGS__)
+
+#endif /* LOG_H */
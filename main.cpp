@@ -28,12 +28,24 @@
 ****************************************************************************/
 
 #include "themewidget.h"
+#include "log.h"
+#include "trace.h"
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QMainWindow>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    // Where QSettings keeps the athlete's thresholds
+    QCoreApplication::setOrganizationName("OpenCyclingTraining");
+    QCoreApplication::setApplicationName("OpenCyclingTraining");
+    // Trace from the start, the loading included; the perf panel switches it
+    // at run time
+    if (qEnvironmentVariableIsSet("OPENCYCLINGTRAINING_TRACE"))
+        setTracingEnabled(true);
+    // debug, info (default), warning, error or off
+    if (qEnvironmentVariableIsSet("OPENCYCLINGTRAINING_LOG"))
+        setLogLevel(logLevelFromName(qgetenv("OPENCYCLINGTRAINING_LOG").toLower().toStdString()));
     QMainWindow window;
     ThemeWidget *widget = new ThemeWidget();
     window.setCentralWidget(widget);
@@ -0,0 +1,60 @@
+#include <iostream>
+#include <string>
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+
+#include "sqlitebackend.h"
+#include "trainingjournal.h"
+
+// One-shot migration of a training CSV (snapshot and journal) to an SQLite
+// database, the GUI uses the database as soon as it exists.
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("opencyclingtraining-migrate");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Copy a training CSV and its journal into an SQLite database.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "Training CSV, e.g. test_training.csv.");
+    parser.addPositionalArgument("output", "Database to create, e.g. test_training.db.");
+    QCommandLineOption force(QStringList()<<"f"<<"force", "Replace the content of an existing database.");
+    parser.addOption(force);
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.size() != 2)
+        parser.showHelp(1);
+    const std::string input = arguments.at(0).toStdString();
+    const std::string output = arguments.at(1).toStdString();
+    if (!QFile::exists(arguments.at(0))) {
+        std::cout<<"Error: no file "<<input<<std::endl;
+        return 1;
+    }
+    if (QFile::exists(arguments.at(1)) && !parser.isSet(force)) {
+        std::cout<<"Error: "<<output<<" exists, use --force to replace its content"<<std::endl;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<TrainingFileError> errors;
+    TrainingRecords trainings = TrainingJournal(input).load(&errors);
+    if (!errors.empty())
+        std::cout<<errors.size()<<" faulty records in "<<input<<", see above"<<std::endl;
+    SqliteBackend database(output);
+    if (database.saveAll(trainings) != 0)
+        return 1;
+    // The copy is only trusted once read back
+    const size_t copied = database.load().rows.size();
+    if (copied != trainings.rows.size()) {
+        std::cout<<"Error: "<<copied<<" days read back from "<<output<<" instead of "<<trainings.rows.size()<<std::endl;
+        return 1;
+    }
+    std::cout<<copied<<" days migrated to "<<output<<" in "<<timer.elapsed()<<" ms"<<std::endl;
+    return 0;
+}
@@ -1,12 +1,20 @@
 QT += charts
 requires(qtConfig(combobox))
 
+include(core.pri)
+
 HEADERS += \
-    themewidget.h
+    perfpanel.h \
+    themewidget.h \
+    timechartview.h \
+    trainingtablemodel.h
 
 SOURCES += \
     main.cpp \
-    themewidget.cpp
+    perfpanel.cpp \
+    themewidget.cpp \
+    timechartview.cpp \
+    trainingtablemodel.cpp
 
 target.path = build
 INSTALLS += target
@@ -0,0 +1,90 @@
+#include "perfpanel.h"
+
+#include <QtCore/QTimer>
+#include <QtWidgets/QCheckBox>
+#include <QtWidgets/QFileDialog>
+#include <QtWidgets/QHBoxLayout>
+#include <QtWidgets/QHeaderView>
+#include <QtWidgets/QPushButton>
+#include <QtWidgets/QTableWidget>
+#include <QtWidgets/QVBoxLayout>
+
+#include "trace.h"
+
+PerfPanel::PerfPanel(QWidget *parent):
+    QWidget(parent, Qt::Tool),
+    mTracing(new QCheckBox("Tracing")),
+    mTable(new QTableWidget(0, 5)),
+    mTimer(new QTimer(this))
+{
+    setWindowTitle("Performance");
+    mTracing->setChecked(tracingEnabled());
+    connect(mTracing, &QCheckBox::toggled, this, [](bool checked) { setTracingEnabled(checked); });
+    QPushButton *export_button = new QPushButton("Export trace...");
+    connect(export_button, &QPushButton::clicked, this, &PerfPanel::exportTrace);
+
+    mTable->setHorizontalHeaderLabels(QStringList()<<"Stage"<<"Count"<<"p50 (ms)"<<"p99 (ms)"<<"Max (ms)");
+    mTable->verticalHeader()->setVisible(false);
+    mTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    mTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    QHBoxLayout *buttons = new QHBoxLayout;
+    buttons->addWidget(mTracing);
+    buttons->addStretch();
+    buttons->addWidget(export_button);
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addLayout(buttons);
+    layout->addWidget(mTable);
+    resize(520, 360);
+
+    mTimer->setInterval(1000);
+    connect(mTimer, &QTimer::timeout, this, &PerfPanel::updateStats);
+}
+
+void PerfPanel::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    updateStats();
+    mTimer->start();
+}
+
+void PerfPanel::hideEvent(QHideEvent *event)
+{
+    // Nothing is computed while the panel is closed
+    mTimer->stop();
+    QWidget::hideEvent(event);
+}
+
+void PerfPanel::updateStats()
+{
+    mTracing->setChecked(tracingEnabled());
+    const std::vector<TraceStats> stats = traceStats();
+    mTable->setRowCount(int(stats.size()));
+    for (size_t i = 0; i < stats.size(); i++) {
+        const TraceStats &stat = stats[i];
+        const QString cells[] = {
+            stat.name,
+            QString::number(stat.count),
+            QString::number(stat.p50/1e6, 'f', 3),
+            QString::number(stat.p99/1e6, 'f', 3),
+            QString::number(stat.max/1e6, 'f', 3),
+        };
+        for (int column = 0; column < 5; column++) {
+            QTableWidgetItem *item = mTable->item(int(i), column);
+            if (!item) {
+                item = new QTableWidgetItem;
+                if (column > 0)
+                    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                mTable->setItem(int(i), column, item);
+            }
+            item->setText(cells[column]);
+        }
+    }
+}
+
+void PerfPanel::exportTrace()
+{
+    const QString filename = QFileDialog::getSaveFileName(this, "Export trace", "trace.json", "Chrome trace (*.json)");
+    if (!filename.isEmpty())
+        writeChromeTrace(filename);
+}
@@ -0,0 +1,35 @@
+#ifndef PERFPANEL_H
+#define PERFPANEL_H
+
+#include <QtWidgets/QWidget>
+
+QT_BEGIN_NAMESPACE
+class QCheckBox;
+class QTableWidget;
+class QTimer;
+QT_END_NAMESPACE
+
+// Hidden tool window (Ctrl+Shift+P) with the p50/p99 of the traced stages,
+// refreshed every second while it is shown. Tracing can be switched on from
+// it and the events saved as a Chrome trace.
+class PerfPanel: public QWidget
+{
+    Q_OBJECT
+public:
+    explicit PerfPanel(QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private Q_SLOTS:
+    void updateStats();
+    void exportTrace();
+
+private:
+    QCheckBox *mTracing;
+    QTableWidget *mTable;
+    QTimer *mTimer;
+};
+
+#endif /* PERFPANEL_H */
@@ -0,0 +1,99 @@
+#include "powercurve.h"
+
+#include <algorithm>
+
+#include "simd.h"
+#include "trace.h"
+
+namespace {
+
+// max(a[i] - b[i]) for i in [i, n)
+double maxDifferenceScalar(const double *a, const double *b, size_t n, size_t i, double best)
+{
+    for (; i < n; i++)
+        best = std::max(best, a[i] - b[i]);
+    return best;
+}
+
+#if defined(SIMD_AVX)
+__attribute__((target("avx")))
+double maxDifferenceAvx(const double *a, const double *b, size_t n)
+{
+    size_t i = 0;
+    __m256d best0 = _mm256_set1_pd(0.0);
+    __m256d best1 = best0;
+    for (; i + 8 <= n; i += 8) {
+        best0 = _mm256_max_pd(best0, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        best1 = _mm256_max_pd(best1, _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_max_pd(best0, best1));
+    const double best = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    return maxDifferenceScalar(a, b, n, i, best);
+}
+#endif
+
+// Power is never negative, 0 is a neutral start
+double maxDifference(const double *a, const double *b, size_t n)
+{
+#if defined(SIMD_AVX)
+    if (hasAvx())
+        return maxDifferenceAvx(a, b, n);
+#endif
+    size_t i = 0;
+    double best = 0;
+#if defined(SIMD_SSE2)
+    __m128d best0 = _mm_set1_pd(0.0);
+    __m128d best1 = best0;
+    for (; i + 4 <= n; i += 4) {
+        best0 = _mm_max_pd(best0, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        best1 = _mm_max_pd(best1, _mm_sub_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_max_pd(best0, best1));
+    best = std::max(lanes[0], lanes[1]);
+#endif
+    return maxDifferenceScalar(a, b, n, i, best);
+}
+
+} // namespace
+
+std::vector<float> meanMaximalPower(const qint32 *power, size_t count)
+{
+    TRACE_SCOPE("power_curve");
+    std::vector<float> curve(count);
+    // Sums of whole watts, exact in a double
+    std::vector<double> prefix(count + 1, 0.0);
+    for (size_t i = 0; i < count; i++)
+        prefix[i + 1] = prefix[i] + std::max(power[i], 0);
+    for (size_t duration = 1; duration <= count; duration++) {
+        // Windows [i, i + duration) for i in [0, count - duration]
+        const double best = maxDifference(prefix.data() + duration, prefix.data(), count - duration + 1);
+        curve[duration - 1] = float(best/duration);
+    }
+    return curve;
+}
+
+void SeasonBests::add(int season, const std::vector<float> &curve)
+{
+    std::vector<float> &best = mCurves[season];
+    if (best.size() < curve.size())
+        best.resize(curve.size(), 0.0f);
+    for (size_t i = 0; i < curve.size(); i++)
+        best[i] = std::max(best[i], curve[i]);
+}
+
+const std::vector<float> &SeasonBests::curve(int season) const
+{
+    static const std::vector<float> empty;
+    auto found = mCurves.find(season);
+    return found != mCurves.end() ? found->second : empty;
+}
+
+std::vector<int> SeasonBests::seasons() const
+{
+    std::vector<int> seasons;
+    for (const auto &season: mCurves)
+        seasons.push_back(season.first);
+    return seasons;
+}
@@ -0,0 +1,31 @@
+#ifndef POWERCURVE_H
+#define POWERCURVE_H
+
+#include <map>
+#include <vector>
+
+#include <QtCore/QtGlobal>
+
+// Mean-maximal power: curve[d-1] is the best average power held for d
+// seconds, for every d from 1 s to the length of the activity. `power` has
+// one value per second.
+//
+// The average of any window is a difference of prefix sums, so a duration is
+// one pass of subtractions and max over the activity (SIMD), the whole curve
+// O(n^2/2) of them.
+std::vector<float> meanMaximalPower(const qint32 *power, size_t count);
+
+// Best curve of each season (calendar year), the pointwise max of the curves
+// of its activities. Adding an activity only touches its season.
+class SeasonBests {
+public:
+    void add(int season, const std::vector<float> &curve);
+    // Empty when the season has no activity
+    const std::vector<float> &curve(int season) const;
+    std::vector<int> seasons() const;
+
+private:
+    std::map<int, std::vector<float>> mCurves;
+};
+
+#endif /* POWERCURVE_H */
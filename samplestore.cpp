@@ -0,0 +1,245 @@
+#include "samplestore.h"
+
+#include <cstring>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDir>
+#include <QtCore/QSaveFile>
+
+#include "log.h"
+
+namespace {
+
+const char kMagic[4] = {'O', 'C', 'T', 'S'};
+const int kVersion = 1;
+// magic, version, section count, sample count, start
+const int kHeaderSize = 4 + 2 + 2 + 4 + 8;
+const char kSuffix[] = ".samples";
+const char kDateFormat[] = "yyyy-MM-dd";
+
+void appendValue(QByteArray &data, quint64 value, int size) {
+    for (int i = 0; i < size; i++)
+        data.append(char((value >> (8*i)) & 0xff));
+}
+
+quint64 readValue(const uchar *p, int size) {
+    quint64 value = 0;
+    for (int i = 0; i < size; i++)
+        value |= quint64(p[i]) << (8*i);
+    return value;
+}
+
+void appendDeltas(QByteArray &data, const std::vector<qint32> &values) {
+    qint32 previous = 0;
+    for (qint32 value: values) {
+        const qint32 delta = value - previous;
+        previous = value;
+        // Zigzag: small negative deltas stay small
+        quint32 bits = (quint32(delta) << 1) ^ quint32(delta >> 31);
+        while (bits >= 0x80) {
+            data.append(char((bits & 0x7f) | 0x80));
+            bits >>= 7;
+        }
+        data.append(char(bits));
+    }
+}
+
+} // namespace
+
+void ActivitySamples::append(qint32 power, qint32 hr, qint32 cadence, qint32 speed)
+{
+    columns[Power].push_back(power);
+    columns[HeartRate].push_back(hr);
+    columns[Cadence].push_back(cadence);
+    columns[Speed].push_back(speed);
+}
+
+int writeSampleFile(const QString &filename, const ActivitySamples &samples, const std::vector<float> &power_curve)
+{
+    const int sections = ActivitySamples::ColumnCount + 1;
+    QByteArray body;
+    quint32 offsets[sections];
+    quint32 sizes[sections];
+    const quint32 data_start = kHeaderSize + 8*sections;
+    for (int column = 0; column < ActivitySamples::ColumnCount; column++) {
+        offsets[column] = data_start + body.size();
+        appendDeltas(body, samples.columns[column]);
+        sizes[column] = data_start + body.size() - offsets[column];
+    }
+    offsets[sections - 1] = data_start + body.size();
+    for (float value: power_curve) {
+        quint32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        appendValue(body, bits, 4);
+    }
+    sizes[sections - 1] = 4*quint32(power_curve.size());
+
+    QByteArray data;
+    data.reserve(data_start + body.size());
+    data.append(kMagic, 4);
+    appendValue(data, kVersion, 2);
+    appendValue(data, sections, 2);
+    appendValue(data, samples.size(), 4);
+    appendValue(data, quint64(samples.start), 8);
+    for (int section = 0; section < sections; section++) {
+        appendValue(data, offsets[section], 4);
+        appendValue(data, sizes[section], 4);
+    }
+    data.append(body);
+
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        LOG_ERROR("Cannot save samples to "<<filename.toStdString());
+        return 1;
+    }
+    return 0;
+}
+
+SampleFile::SampleFile():
+    mData(nullptr),
+    mSize(0),
+    mCount(0),
+    mStart(0)
+{
+}
+
+SampleFile::~SampleFile()
+{
+    close();
+}
+
+bool SampleFile::open(const QString &filename)
+{
+    close();
+    mFile.setFileName(filename);
+    if (!mFile.open(QIODevice::ReadOnly))
+        return false;
+    mSize = mFile.size();
+    const int sections = kSections;
+    if (mSize < kHeaderSize + 8*sections || !(mData = mFile.map(0, mSize))) {
+        close();
+        return false;
+    }
+    if (std::memcmp(mData, kMagic, 4) != 0 || readValue(mData + 4, 2) != kVersion || readValue(mData + 6, 2) != quint64(sections)) {
+        close();
+        return false;
+    }
+    mCount = readValue(mData + 8, 4);
+    mStart = qint64(readValue(mData + 12, 8));
+    for (int section = 0; section < sections; section++) {
+        mOffsets[section] = quint32(readValue(mData + kHeaderSize + 8*section, 4));
+        mSizes[section] = quint32(readValue(mData + kHeaderSize + 8*section + 4, 4));
+        if (quint64(mOffsets[section]) + mSizes[section] > quint64(mSize)) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void SampleFile::close()
+{
+    if (mData)
+        mFile.unmap(const_cast<uchar *>(mData));
+    mData = nullptr;
+    mSize = 0;
+    mCount = 0;
+    mStart = 0;
+    mFile.close();
+}
+
+std::vector<qint32> SampleFile::column(ActivitySamples::Column column) const
+{
+    std::vector<qint32> values;
+    if (!mData)
+        return values;
+    values.reserve(mCount);
+    const uchar *p = mData + mOffsets[column];
+    const uchar *end = p + mSizes[column];
+    qint32 value = 0;
+    while (p < end && values.size() < mCount) {
+        quint32 bits = 0;
+        int shift = 0;
+        while (p < end && (*p & 0x80) && shift < 28) {
+            bits |= quint32(*p++ & 0x7f) << shift;
+            shift += 7;
+        }
+        if (p == end)
+            break;
+        bits |= quint32(*p++) << shift;
+        value += qint32((bits >> 1) ^ (0u - (bits & 1)));
+        values.push_back(value);
+    }
+    return values;
+}
+
+std::vector<float> SampleFile::powerCurve() const
+{
+    std::vector<float> curve;
+    if (!mData)
+        return curve;
+    const int section = kSections - 1;
+    curve.resize(mSizes[section]/4);
+    for (size_t i = 0; i < curve.size(); i++) {
+        const quint32 bits = quint32(readValue(mData + mOffsets[section] + 4*i, 4));
+        std::memcpy(&curve[i], &bits, sizeof(bits));
+    }
+    return curve;
+}
+
+SampleStore::SampleStore(const QString &directory):
+    mDirectory(directory)
+{
+}
+
+QString SampleStore::filename(const QDate &date, const QString &name) const
+{
+    return QDir(mDirectory).filePath(date.toString(kDateFormat) + "_" + name + kSuffix);
+}
+
+void SampleStore::scan()
+{
+    mFiles.clear();
+    const QDir directory(mDirectory);
+    const QStringList names = directory.entryList(QStringList() << QString("*") + kSuffix, QDir::Files, QDir::Name);
+    const int date_size = int(std::strlen(kDateFormat));
+    for (const QString &name: names) {
+        const QDate date = QDate::fromString(name.left(date_size), kDateFormat);
+        if (date.isValid())
+            mFiles[date.toJulianDay()].append(directory.filePath(name));
+    }
+}
+
+void SampleStore::add(const QDate &date, const QString &filename)
+{
+    QStringList &files = mFiles[date.toJulianDay()];
+    if (!files.contains(filename))
+        files.append(filename);
+}
+
+QStringList SampleStore::files(const QDate &date) const
+{
+    auto found = mFiles.find(date.toJulianDay());
+    return found != mFiles.end() ? found->second : QStringList();
+}
+
+std::vector<QDate> SampleStore::days() const
+{
+    std::vector<QDate> days;
+    for (const auto &day: mFiles)
+        days.push_back(QDate::fromJulianDay(day.first));
+    return days;
+}
+
+SeasonBests loadSeasonBests(const SampleStore &store)
+{
+    SeasonBests bests;
+    for (const QDate &day: store.days()) {
+        for (const QString &filename: store.files(day)) {
+            SampleFile file;
+            if (file.open(filename))
+                bests.add(day.year(), file.powerCurve());
+        }
+    }
+    return bests;
+}
@@ -0,0 +1,91 @@
+#ifndef SAMPLESTORE_H
+#define SAMPLESTORE_H
+
+#include <map>
+#include <vector>
+
+#include <QtCore/QDate>
+#include <QtCore/QFile>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include "powercurve.h"
+
+// One value per second of an activity, pauses removed
+class ActivitySamples {
+public:
+    enum Column {
+        Power,      // W
+        HeartRate,  // bpm
+        Cadence,    // rpm
+        Speed,      // cm/s
+        ColumnCount
+    };
+
+    qint64 start = 0;   // s since epoch of the first second
+    std::vector<qint32> columns[ColumnCount]; // 0 when the field is missing
+
+    size_t size() const { return columns[Power].size(); }
+    void append(qint32 power, qint32 hr, qint32 cadence, qint32 speed);
+};
+
+// Sample file: a small header, then each column as zigzag varints of the
+// differences between consecutive seconds (one or two bytes a second for a
+// ride), then the mean-maximal power curve as raw floats so that the season
+// bests never decode the samples.
+int writeSampleFile(const QString &filename, const ActivitySamples &samples, const std::vector<float> &power_curve);
+
+// A memory-mapped sample file, columns are decoded on demand
+class SampleFile {
+public:
+    SampleFile();
+    ~SampleFile();
+
+    bool open(const QString &filename);
+    void close();
+    bool isOpen() const { return mData != nullptr; }
+
+    size_t size() const { return mCount; }
+    qint64 start() const { return mStart; }
+    std::vector<qint32> column(ActivitySamples::Column column) const;
+    std::vector<float> powerCurve() const;
+
+private:
+    // The columns then the power curve
+    static const int kSections = ActivitySamples::ColumnCount + 1;
+
+    QFile mFile;
+    const uchar *mData;
+    qint64 mSize;
+    size_t mCount;
+    qint64 mStart;
+    quint32 mOffsets[kSections];
+    quint32 mSizes[kSections];
+};
+
+// The sample files of the activities, one "<yyyy-MM-dd>_<name>.samples" per
+// activity in a directory: the date links a file to its day of the training
+// file.
+class SampleStore {
+public:
+    explicit SampleStore(const QString &directory = QString());
+
+    const QString &directory() const { return mDirectory; }
+    QString filename(const QDate &date, const QString &name) const;
+    // List the files of the directory
+    void scan();
+    // Record a file written since the scan
+    void add(const QDate &date, const QString &filename);
+    QStringList files(const QDate &date) const;
+    // Days with samples, in order
+    std::vector<QDate> days() const;
+
+private:
+    QString mDirectory;
+    std::map<qint64, QStringList> mFiles; // julian day, file names
+};
+
+// Season bests from the curves stored in the files
+SeasonBests loadSeasonBests(const SampleStore &store);
+
+#endif /* SAMPLESTORE_H */
@@ -0,0 +1,26 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// The vector instructions the kernels may use. SSE2 is part of the build
+// target, AVX is picked at runtime with hasAvx(): the build itself keeps
+// targeting plain x86-64, the AVX functions are compiled with
+// __attribute__((target("avx"))).
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_SSE2
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIMD_AVX
+
+// Whether the CPU running the program has AVX
+inline bool hasAvx()
+{
+    static const bool has_avx = (__builtin_cpu_init(), __builtin_cpu_supports("avx"));
+    return has_avx;
+}
+#endif
+
+#endif /* SIMD_H */
@@ -0,0 +1,276 @@
+#include "sqlitebackend.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+#include <QtCore/QVariant>
+
+#include "log.h"
+#include "trace.h"
+
+namespace {
+
+std::atomic<int> gConnectionCount(0);
+
+const char *const kSchema[] = {
+    "PRAGMA journal_mode=WAL",
+    // Durable at each checkpoint, a power cut may lose the last edits only
+    "PRAGMA synchronous=NORMAL",
+    "CREATE TABLE IF NOT EXISTS trainings ("
+    "day INTEGER PRIMARY KEY, weather TEXT, training TEXT, hour REAL, feeling INTEGER,"
+    " daily_objective TEXT, tss REAL, km REAL, hour_objective REAL, tss_objective REAL,"
+    " category TEXT, muscu TEXT, muscu_objective TEXT, km_per_week_objective REAL,"
+    " hour_per_week_objective REAL, tss_per_week_objective REAL)",
+    "CREATE INDEX IF NOT EXISTS trainings_category ON trainings (category, day)"
+};
+
+// In TrainingItem order, the day first
+const char kSelect[] =
+    "SELECT day, weather, training, hour, feeling, daily_objective, tss, km,"
+    " hour_objective, tss_objective, category, muscu, muscu_objective,"
+    " km_per_week_objective, hour_per_week_objective, tss_per_week_objective FROM trainings";
+
+const char kUpsert[] =
+    "INSERT OR REPLACE INTO trainings VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+
+void reportError(const std::string &filename, const QSqlError &error)
+{
+    LOG_ERROR("Database "<<filename<<": "<<error.text().toStdString());
+}
+
+void bindItem(QSqlQuery &query, const TrainingItem &item)
+{
+    query.addBindValue(item.date.toJulianDay());
+    query.addBindValue(item.weather);
+    query.addBindValue(item.training);
+    query.addBindValue(item.hour);
+    query.addBindValue(int(item.feeling));
+    query.addBindValue(item.daily_objective);
+    query.addBindValue(item.TSS);
+    query.addBindValue(item.Km_per_day);
+    query.addBindValue(item.hour_objective);
+    query.addBindValue(item.TSS_objective);
+    query.addBindValue(item.category);
+    query.addBindValue(item.muscu);
+    query.addBindValue(item.muscu_objective);
+    query.addBindValue(item.km_per_week_objective);
+    query.addBindValue(item.hour_per_week_objective);
+    query.addBindValue(item.TSS_per_week_objective);
+}
+
+TrainingRecords readRecords(QSqlQuery &query)
+{
+    TrainingRecords trainings;
+    StringPool &strings = trainings.strings;
+    while (query.next()) {
+        TrainingRecord record;
+        record.day = query.value(0).toInt();
+        record.weather = strings.intern(query.value(1).toString());
+        record.training = strings.intern(query.value(2).toString());
+        record.hour = query.value(3).toFloat();
+        record.feeling = quint8(std::min(std::max(query.value(4).toInt(), 0), 255));
+        record.daily_objective = strings.intern(query.value(5).toString());
+        record.TSS = query.value(6).toFloat();
+        record.Km_per_day = query.value(7).toFloat();
+        record.hour_objective = query.value(8).toFloat();
+        record.TSS_objective = query.value(9).toFloat();
+        record.category = strings.intern(query.value(10).toString());
+        record.muscu = strings.intern(query.value(11).toString());
+        record.muscu_objective = strings.intern(query.value(12).toString());
+        record.km_per_week_objective = query.value(13).toFloat();
+        record.hour_per_week_objective = query.value(14).toFloat();
+        record.TSS_per_week_objective = query.value(15).toFloat();
+        trainings.rows.push_back(record);
+    }
+    return trainings;
+}
+
+} // namespace
+
+// A connection of the calling thread, with the schema created; removed with
+// the object
+class SqliteConnection {
+public:
+    explicit SqliteConnection(const std::string &filename):
+        mFilename(filename),
+        mName(QString("opencyclingtraining-%1").arg(gConnectionCount++)),
+        mOpen(false)
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", mName);
+        database.setDatabaseName(QString::fromStdString(filename));
+        if (!database.open()) {
+            reportError(filename, database.lastError());
+            return;
+        }
+        QSqlQuery query(database);
+        for (const char *statement: kSchema) {
+            if (!query.exec(statement)) {
+                reportError(filename, query.lastError());
+                return;
+            }
+        }
+        mOpen = true;
+    }
+
+    ~SqliteConnection() {
+        QSqlDatabase::database(mName, false).close();
+        QSqlDatabase::removeDatabase(mName);
+    }
+
+    bool isOpen() const { return mOpen; }
+    QSqlDatabase database() const { return QSqlDatabase::database(mName, false); }
+
+private:
+    std::string mFilename;
+    QString mName;
+    bool mOpen;
+};
+
+// The connection of a thread reading the database, its queries prepared once
+class SqliteReader {
+public:
+    explicit SqliteReader(const std::string &filename):
+        connection(filename),
+        range(connection.database()),
+        category_range(connection.database()),
+        ready(false)
+    {
+        if (!connection.isOpen())
+            return;
+        range.setForwardOnly(true);
+        category_range.setForwardOnly(true);
+        // Primary key range, or the (category, day) index
+        const QString statement = QString(kSelect) + " WHERE day BETWEEN ? AND ?";
+        if (!range.prepare(statement + " ORDER BY day")) {
+            reportError(filename, range.lastError());
+            return;
+        }
+        if (!category_range.prepare(statement + " AND category = ? ORDER BY day")) {
+            reportError(filename, category_range.lastError());
+            return;
+        }
+        ready = true;
+    }
+
+    // The queries before their connection
+    SqliteConnection connection;
+    QSqlQuery range;
+    QSqlQuery category_range;
+    bool ready;
+};
+
+SqliteBackend::SqliteBackend(const std::string &filename):
+    mFilename(filename)
+{
+}
+
+SqliteBackend::~SqliteBackend()
+{
+    // The query before its connection. The readers of the other threads go
+    // with their thread.
+    mUpsert.reset();
+    mSaveConnection.reset();
+    if (mReaders.hasLocalData())
+        mReaders.setLocalData(nullptr);
+}
+
+SqliteReader *SqliteBackend::reader()
+{
+    if (!mReaders.hasLocalData())
+        mReaders.setLocalData(new SqliteReader(mFilename));
+    return mReaders.localData();
+}
+
+TrainingRecords SqliteBackend::load(std::vector<TrainingFileError> *errors)
+{
+    TRACE_SCOPE("database.load");
+    (void)errors; // the rows are typed, nothing to parse
+    SqliteReader *connection = reader();
+    if (!connection->ready)
+        return TrainingRecords();
+    QSqlQuery query(connection->connection.database());
+    query.setForwardOnly(true);
+    if (!query.exec(QString(kSelect) + " ORDER BY day")) {
+        reportError(mFilename, query.lastError());
+        return TrainingRecords();
+    }
+    return readRecords(query);
+}
+
+TrainingRecords SqliteBackend::query(const QDate &from, const QDate &to, const QString &category)
+{
+    TRACE_SCOPE("database.query");
+    SqliteReader *connection = reader();
+    if (!connection->ready)
+        return TrainingRecords();
+    QSqlQuery &query = category.isEmpty() ? connection->range : connection->category_range;
+    query.addBindValue(from.toJulianDay());
+    query.addBindValue(to.toJulianDay());
+    if (!category.isEmpty())
+        query.addBindValue(category);
+    if (!query.exec()) {
+        reportError(mFilename, query.lastError());
+        return TrainingRecords();
+    }
+    TrainingRecords trainings = readRecords(query);
+    // Done with the statement until the next range
+    query.finish();
+    return trainings;
+}
+
+int SqliteBackend::save(const TrainingItem &item)
+{
+    TRACE_SCOPE("database.save");
+    QMutexLocker lock(&mSaveMutex);
+    if (!mSaveConnection) {
+        mSaveConnection.reset(new SqliteConnection(mFilename));
+        if (mSaveConnection->isOpen()) {
+            mUpsert.reset(new QSqlQuery(mSaveConnection->database()));
+            if (!mUpsert->prepare(kUpsert)) {
+                reportError(mFilename, mUpsert->lastError());
+                mUpsert.reset();
+            }
+        }
+    }
+    if (!mUpsert)
+        return 1;
+    bindItem(*mUpsert, item);
+    if (!mUpsert->exec()) {
+        reportError(mFilename, mUpsert->lastError());
+        return 1;
+    }
+    return 0;
+}
+
+int SqliteBackend::saveAll(const TrainingRecords &trainings)
+{
+    TRACE_SCOPE("database.save_all");
+    SqliteConnection connection(mFilename);
+    if (!connection.isOpen())
+        return 1;
+    QSqlDatabase database = connection.database();
+    // One transaction: a single sync for the whole table
+    database.transaction();
+    {
+        QSqlQuery query(database);
+        bool ok = query.exec("DELETE FROM trainings") && query.prepare(kUpsert);
+        for (size_t row = 0; ok && row < trainings.rows.size(); row++) {
+            bindItem(query, trainings.item(row));
+            ok = query.exec();
+        }
+        if (!ok) {
+            reportError(mFilename, query.lastError());
+            query.finish();
+            database.rollback();
+            return 1;
+        }
+    }
+    if (!database.commit()) {
+        reportError(mFilename, database.lastError());
+        return 1;
+    }
+    return 0;
+}
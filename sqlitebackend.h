@@ -0,0 +1,50 @@
+#ifndef SQLITEBACKEND_H
+#define SQLITEBACKEND_H
+
+#include <memory>
+
+#include <QtCore/QMutex>
+#include <QtCore/QThreadStorage>
+
+#include "trainingbackend.h"
+
+QT_BEGIN_NAMESPACE
+class QSqlQuery;
+QT_END_NAMESPACE
+
+class SqliteConnection;
+class SqliteReader;
+
+// Trainings in an SQLite database through QtSql, one row per day.
+//
+// The Julian day is the primary key, so a date range is read from the
+// table's own b-tree and only the rows of the range are visited; an index on
+// (category, day) serves the category queries. The database is in WAL mode:
+// saving a day is a single prepared upsert and readers are never blocked.
+// A QSqlDatabase connection cannot be used from several threads: each thread
+// reading keeps its own with the range queries prepared, save() keeps one for
+// the thread saving.
+class SqliteBackend: public TrainingBackend {
+public:
+    explicit SqliteBackend(const std::string &filename);
+    ~SqliteBackend() override;
+
+    TrainingRecords load(std::vector<TrainingFileError> *errors = nullptr) override;
+    TrainingRecords query(const QDate &from, const QDate &to, const QString &category = QString()) override;
+    int save(const TrainingItem &item) override;
+    // Replace the whole content in one transaction
+    int saveAll(const TrainingRecords &trainings);
+
+    const std::string &filename() const override { return mFilename; }
+
+private:
+    SqliteReader *reader();
+
+    std::string mFilename;
+    QThreadStorage<SqliteReader *> mReaders;
+    QMutex mSaveMutex;
+    std::unique_ptr<SqliteConnection> mSaveConnection;
+    std::unique_ptr<QSqlQuery> mUpsert;     // prepared on mSaveConnection
+};
+
+#endif /* SQLITEBACKEND_H */
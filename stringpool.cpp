@@ -0,0 +1,53 @@
+#include "stringpool.h"
+
+StringPool::StringPool()
+{
+    clear();
+}
+
+quint32 StringPool::intern(const QString &text)
+{
+    if (text.isEmpty())
+        return 0;
+    auto found = mCodes.find(text);
+    if (found != mCodes.end())
+        return found->second;
+    return add(text);
+}
+
+quint32 StringPool::intern(std::string_view utf8)
+{
+    if (utf8.empty())
+        return 0;
+    mKey.assign(utf8.data(), utf8.size());
+    auto found = mUtf8Codes.find(mKey);
+    if (found != mUtf8Codes.end())
+        return found->second;
+    // Known under its QString form when it was interned as such first
+    const quint32 code = intern(QString::fromUtf8(utf8.data(), int(utf8.size())));
+    mUtf8Codes.emplace(mKey, code);
+    return code;
+}
+
+quint32 StringPool::find(const QString &text) const
+{
+    if (text.isEmpty())
+        return 0;
+    auto found = mCodes.find(text);
+    return found != mCodes.end() ? found->second : kNotFound;
+}
+
+void StringPool::clear()
+{
+    mTexts.assign(1, QString());
+    mCodes.clear();
+    mUtf8Codes.clear();
+}
+
+quint32 StringPool::add(const QString &text)
+{
+    const quint32 code = quint32(mTexts.size());
+    mTexts.push_back(text);
+    mCodes.emplace(text, code);
+    return code;
+}
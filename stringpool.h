@@ -0,0 +1,51 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <QtCore/QString>
+
+// Interning dictionary for the text fields that repeat from row to row
+// (weather, category, objectives).
+//
+// Each distinct value is stored once and identified by a small code, so the
+// rows keep a quint32 instead of their own copy of the text, and comparing or
+// grouping two rows by such a field is an integer comparison. The QStrings
+// handed out by text() share the pool's data (implicit sharing), decoding a
+// row allocates nothing. Code 0 is the empty string. Codes are never reused:
+// a value no longer referenced stays until clear().
+class StringPool {
+public:
+    static const quint32 kNotFound = 0xffffffff;
+
+    StringPool();
+
+    quint32 intern(const QString &text);
+    // Same from UTF-8, no QString is built when the value is known already
+    quint32 intern(std::string_view utf8);
+    // Code of `text`, kNotFound when it was never interned
+    quint32 find(const QString &text) const;
+
+    const QString &text(quint32 code) const { return mTexts[code]; }
+    size_t size() const { return mTexts.size(); }
+    // Forget every value, only the empty string is left
+    void clear();
+
+private:
+    class Hash {
+    public:
+        size_t operator()(const QString &text) const { return qHash(text); }
+    };
+
+    quint32 add(const QString &text);
+
+    std::vector<QString> mTexts;
+    std::unordered_map<QString, quint32, Hash> mCodes;
+    std::unordered_map<std::string, quint32> mUtf8Codes; // filled by intern(utf8) only
+    std::string mKey;                                    // lookup buffer of intern(utf8)
+};
+
+#endif /* STRINGPOOL_H */
@@ -29,9 +29,23 @@
 
 #include "themewidget.h"
 #include "ui_themewidget.h"
-
-#include <iostream>
-#include <fstream>
+#include "loadmodel.h"
+#include "log.h"
+#include "perfpanel.h"
+#include "trainingfile.h"
+#include "trainingitem.h"
+#include "trainingloader.h"
+#include "trainingstore.h"
+#include "trainingsummary.h"
+#include "trainingtablemodel.h"
+#include "timechartview.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <iterator>
+#include <set>
 #include <string>
 
 #include <QtCharts/QChartView>
@@ -54,239 +68,124 @@
 #include <QtWidgets/QCheckBox>
 #include <QtWidgets/QGroupBox>
 #include <QtWidgets/QLabel>
+#include <QtWidgets/QDateEdit>
+#include <QtWidgets/QFileDialog>
+#include <QtWidgets/QHeaderView>
+#include <QtWidgets/QShortcut>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QRandomGenerator>
+#include <QtCore/QSettings>
+#include <QtCore/QTimer>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtCharts/QBarCategoryAxis>
 #include <QtWidgets/QApplication>
 #include <QtCharts/QValueAxis>
 
-const double fatigue_coef[] = {0.06, 0.07, 0.09, 0.14, 0.19, 0.22, 0.23};
-
-const double fitness_coef_factor = 1.4;
-const double fitness_coef[] = {0.007,0.008,0.009,0.01,0.011,0.012,0.013,0.014,0.015,0.016,0.017,0.018,0.019,0.02,0.021,0.022,0.023,0.025,0.026,0.027,0.028,0.03,0.0315,0.032,0.032,0.033,0.034,0.035,0.036,0.037,0.037,0.037,0.036,0.035,0.034,0.0335,0.033,0.032,0.031};
-
-class TrainingWeek {
-public:
-        int week_number;
-        int year;
-        int month;
-        double sum_hour;
-        double sum_tss;
-        double sum_km;
-        double sum_hour_objective;
-        double sum_tss_objective;
-        double sum_km_objective;
-        QString category;
-        QString comment;
-};
-
-class TrainingItem {
-public:
-    QString weather;
-    QDate date;
-    QString training;
-    double hour;
-    unsigned short int feeling;
-    QString daily_objective;
-    double TSS;
-    double Km_per_day;
-    double hour_objective;
-    double TSS_objective;
-    QString category;
-    QString muscu;
-    QString muscu_objective;
-    double km_per_week_objective;
-    double hour_per_week_objective;
-    double TSS_per_week_objective;
-};
-
-std::vector<TrainingItem> loadTrainingsFromFile(std::string filename) {
-    std::vector<TrainingItem> database;
-    std::string line;
-    std::ifstream myfile (filename);
-
-    if (!myfile.is_open()) {
-        std::cout<<"Error: Cannot load training data from "<<filename<<std::endl;
-        return std::vector<TrainingItem>();
-    }
+namespace {
 
-    while (std::getline(myfile, line)) {
-        TrainingItem current_item;
-        std::string buffer;
-        bool in_apo = false;
-        int count_items = 0;
-        int count_lines = 0;
-
-        for (const char &c: line) {
-            if (c == '"') {
-                in_apo = !in_apo;
-            } else if (c == ',' && !in_apo) {
-                // save current item and start parsing next one
-                if (count_items == 0) {
-                    current_item.weather = QString::fromStdString(buffer);
-                } else if (count_items == 1) {
-                    current_item.date = QDate::fromString(QString::fromStdString(buffer));
-                } else if (count_items == 2) {
-                     current_item.training = QString::fromStdString(buffer);
-                } else if (count_items == 3) {
-                    try {
-                        current_item.hour = std::stod(buffer);
-                    } catch (...) {
-                        std::cout<<"Error: "<<buffer<<"is not a double"<<std::endl;
-                    }
-                } else if (count_items == 4) {
-                    current_item.feeling = (unsigned short int)std::stoi(buffer);
-                } else if (count_items == 5) {
-                    current_item.daily_objective = QString::fromStdString(buffer);
-                } else if (count_items == 6) {
-                    try {
-                        current_item.TSS = std::stod(buffer);
-                    } catch (...) {
-                        std::cout<<"Error: "<<buffer<<"is not a double"<<std::endl;
-                    }
-                } else if (count_items == 7) {
-                    try {
-                        current_item.Km_per_day = std::stod(buffer);
-                    } catch (...) {
-                        std::cout<<"Error: "<<buffer<<"is not a double"<<std::endl;
-                    }
-                } else if (count_items == 8) {
-                    current_item.hour_objective = std::stod(buffer);
-                } else if (count_items == 9) {
-                    current_item.TSS_objective = std::stod(buffer);
-                } else if (count_items == 10) {
-                    current_item.category = QString::fromStdString(buffer);
-                } else if (count_items == 11) {
-                    current_item.muscu = QString::fromStdString(buffer);
-                } else if (count_items == 12) {
-                    current_item.muscu_objective = QString::fromStdString(buffer);
-                } else if (count_items == 13) {
-                    current_item.km_per_week_objective = std::stod(buffer);
-                } else if (count_items == 14) {
-                    current_item.hour_per_week_objective = std::stod(buffer);
-                } else if (count_items == 15) {
-                    current_item.TSS_per_week_objective = std::stod(buffer);
-                    database.push_back(current_item);
-                } else {
-                    std::cout<<"Error: Line "<<count_lines<<"Too many items"<<std::endl;
-                }
-                count_items++;
-                buffer.clear();
-            } else {
-                buffer.push_back(c);
-            }
-        }
-        count_lines++;
-    }
-    myfile.close();
+// Series of the charts, in the order they are added
+enum { WeekKm, WeekTSS, WeekHours };
+enum { LoadATL, LoadCTL, LoadTSB, LoadPlanATL, LoadPlanCTL, LoadPlanTSB };
 
-    return database;
+// Position of a day on the date axes. A day is 24 h from a fixed midnight,
+// DST shifts are less than a pixel, and a day keeps its x when the history
+// grows before it.
+double dayX(qint64 day) {
+    static const qint64 anchor = QDate(2000, 1, 1).toJulianDay();
+    static const double origin = QDate(2000, 1, 1).startOfDay().toMSecsSinceEpoch();
+    return origin + (day - anchor)*86400000.0;
 }
 
-int saveTrainingsToFile(std::string filename, const std::vector<TrainingItem> &trainings) {
-    std::ofstream myfile;
-    size_t line_count = 0;
-    myfile.open(filename);
-    if (!myfile.is_open()) {
-        std::cout<<"Error: Cannot save training to "<<filename<<std::endl;
-        return 1;
+// Chart points of the weeks starting in [from, to], Julian days
+void weekPoints(const std::vector<TrainingWeek> &weeks, qint64 from, qint64 to,
+                std::vector<QPointF> &km, std::vector<QPointF> &tss, std::vector<QPointF> &hours) {
+    auto it = std::partition_point(weeks.begin(), weeks.end(), [from](const TrainingWeek &week) {
+        return weekStart(week).toJulianDay() < from;
+    });
+    for (; it != weeks.end() && weekStart(*it).toJulianDay() <= to; ++it) {
+        const double x = weekStart(*it).startOfDay().toMSecsSinceEpoch();
+        km.emplace_back(x, it->sum_km);
+        tss.emplace_back(x, it->sum_tss);
+        hours.emplace_back(x, it->sum_hour);
     }
-    for (auto it = trainings.begin(); it != trainings.end(); it++) {
-        myfile << "\"" << it->weather.toUtf8().constData() << "\",";
-        myfile << "\"" << it->date.toString().toUtf8().constData() << "\",";
-        myfile << "\"" << it->training.toUtf8().constData() << "\",";
-        myfile << "\"" << it->hour << "\",";
-        myfile << "\"" << it->feeling << "\",";
-        myfile << "\"" << it->daily_objective.toUtf8().constData() << "\",";
-        myfile << "\"" << it->TSS << "\",";
-        myfile << "\"" << it->Km_per_day << "\",";
-        myfile << "\"" << it->hour_objective << "\",";
-        myfile << "\"" << it->TSS_objective << "\",";
-        myfile << "\"" << it->category.toUtf8().constData() << "\",";
-        myfile << "\"" << it->muscu.toUtf8().constData() << "\",";
-        myfile << "\"" << it->muscu_objective.toUtf8().constData() << "\",";
-        myfile << "\"" << it->km_per_week_objective << "\",";
-        myfile << "\"" << it->hour_per_week_objective << "\",";
-        myfile << "\"" << it->TSS_per_week_objective << "\","<<std::endl;
-        line_count++;
-    }
-    std::cout<<"Training datas saved to file "<<filename<<" ("<<line_count<<" lines)"<<std::endl;
-    myfile.close();
-    return 0;
-}
-
-TrainingItem blankDay() {
-    TrainingItem tmp;
-    tmp.weather = QString("Clear");
-    tmp.training = QString();
-    tmp.date = QDate::fromString("01/01/2050","dd/MM/yyyy");
-    tmp.hour = 0.0;
-    tmp.feeling = 0;
-    tmp.daily_objective = QString();
-    tmp.TSS = 0;
-    tmp.Km_per_day = 0;
-    tmp.hour_objective = 0;
-    tmp.TSS_objective = 0;
-    tmp.category = QString();
-    tmp.muscu = QString();
-    tmp.muscu_objective = QString();
-    tmp.km_per_week_objective = 0;
-    tmp.hour_per_week_objective = 0;
-    tmp.TSS_per_week_objective = 0;
-    return tmp;
-}
-
-TrainingWeek blankWeek() {
-    TrainingWeek tmp;
-    tmp.week_number = 0;
-    tmp.year = 0;
-    tmp.month = 0;
-    tmp.sum_hour = 0;
-    tmp.sum_tss = 0;
-    tmp.sum_km = 0;
-    tmp.sum_hour_objective = 0;
-    tmp.sum_tss_objective = 0;
-    tmp.sum_km_objective = 0;
-    QString category = QString();
-    QString comment = QString();
-    return tmp;
-}
-
-void debugPrintTraining(const std::vector<TrainingItem> &trainings)
-{
-    std::cout<<"Trainings contains: "<<trainings.size()<<" entry"<<std::endl;
-    for (auto it = trainings.begin(); it!= trainings.end(); it++) {
-        std::cout<<"Date: "<<it->date.toString().toStdString()<<std::endl;
-        std::cout<<"Weather: "<<it->weather.toStdString()<<std::endl;
-        std::cout<<"Training: "<<it->training.toStdString()<<std::endl;
+}
+
+// Chart points of the load series for the days [from, to]
+void loadPoints(const LoadSeries &fatigue, const LoadSeries &fitness, FormSeries &form, qint64 from, qint64 to,
+                std::vector<QPointF> &fatigue_points, std::vector<QPointF> &fitness_points, std::vector<QPointF> &form_points) {
+    if (to < from)
+        return;
+    const std::vector<double> values = form.range(from, to);
+    const size_t count = size_t(to - from + 1);
+    fatigue_points.reserve(count);
+    fitness_points.reserve(count);
+    form_points.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        const double x = dayX(from + i);
+        fatigue_points.emplace_back(x, fatigue.at(from + i));
+        fitness_points.emplace_back(x, fitness.at(from + i));
+        form_points.emplace_back(x, values[i]);
     }
-    std::cout<<"-----------------"<<std::endl;
 }
 
+} // namespace
+
 ThemeWidget::ThemeWidget(QWidget *parent) :
     QWidget(parent),
     m_listCount(3),
     m_valueMax(10),
     m_valueCount(7),
+    mTssFirstDay(0),
+    mFatigue(fatigue_coef, std::size(fatigue_coef)),
+    mFitness(fitness_coef, std::size(fitness_coef), fitness_coef_factor),
+    mForm(mFitness, mFatigue),
+    mRefreshPending(false),
+    mProposalStart(0),
+    mLoaded(false),
+    mDerived(false),
+    mPainted(false),
+    // The database once the CSV has been migrated
+    mBackend(openTrainingBackend(QFile::exists("test_training.db") ? "test_training.db" : "test_training.csv")),
+    mSamples("samples"),
     m_ui(new Ui_ThemeWidgetForm)
 {
+    mStartup.start();
     m_ui->setupUi(this);
 
-    mTrainings = loadTrainingsFromFile("test_training.csv");
-    debugPrintTraining(mTrainings);
-    updateWeekSummary();
-    updateFatigue();
+    mCalendarModel = new TrainingTableModel(mTrainings, this);
+    m_ui->CalendarWidget->setModel(mCalendarModel);
+    m_ui->CalendarWidget->verticalHeader()->setVisible(false);
+
+    mWeekModel = new TrainingTableModel(mTrainings, this);
+    m_ui->WeekWidget->setModel(mWeekModel);
+    m_ui->WeekWidget->verticalHeader()->setVisible(false);
 
     // Create charts
-    QChartView *chartView;
     /*
+    QChartView *chartView;
     chartView = new QChartView(createLineChart());
     m_ui->GraphGrid->addWidget(chartView, 1, 2);
     m_charts << chartView;
     */
 
-    chartView = new QChartView(createScatterChart());
-    m_ui->GraphGrid->addWidget(chartView, 2, 2);
-    m_charts << chartView;
+    mWeekChart = new TimeChartView("Training per week");
+    mWeekChart->addSeries("Km");
+    mWeekChart->addSeries("TSS");
+    mWeekChart->addSeries("Hours", true);
+    m_ui->GraphGrid->addWidget(mWeekChart, 1, 0);
+    m_charts << mWeekChart;
+
+    mLoadChart = new TimeChartView("Training load");
+    mLoadChart->addSeries("Fatigue (ATL)");
+    mLoadChart->addSeries("Fitness (CTL)");
+    mLoadChart->addSeries("Form (TSB)");
+    mLoadChart->addSeries("Planned fatigue");
+    mLoadChart->addSeries("Planned fitness");
+    mLoadChart->addSeries("Planned form");
+    m_ui->GraphGrid->addWidget(mLoadChart, 2, 0);
+    m_charts << mLoadChart;
 
     // Set the colors from the light theme as default ones
     QPalette pal = qApp->palette();
@@ -294,29 +193,130 @@ ThemeWidget::ThemeWidget(QWidget *parent) :
     pal.setColor(QPalette::WindowText, QRgb(0x404044));
     qApp->setPalette(pal);
 
-    mTableHeader<<"Date"<<"Weather"<<"Description"<<"Target"<<"TSS"<<"TSS obj."<<"Km"<<"Km obj."<<"Feeling"<<"Duration"<<"Duration obj."<<"Musculation"<<"Muscu Target";
-
-    m_ui->CalendarWidget->setRowCount(1);
-    m_ui->CalendarWidget->setColumnCount(13);
-    m_ui->CalendarWidget->setHorizontalHeaderLabels(mTableHeader);
-    m_ui->CalendarWidget->verticalHeader()->setVisible(false);
-
-    m_ui->WeekWidget->setRowCount(7);
-    m_ui->WeekWidget->setColumnCount(13);
-    m_ui->WeekWidget->setHorizontalHeaderLabels(mTableHeader);
-    m_ui->WeekWidget->verticalHeader()->setVisible(false);
-
     QDate today = QDate::currentDate();
     m_ui->dateEdit->setDate(today);
+    connect(m_ui->dateEdit, &QDateEdit::dateChanged, this, &ThemeWidget::updateForm);
+    // The calendar and the edits work on the seasons in memory
+    connect(m_ui->dateEdit, &QDateEdit::dateChanged, this, &ThemeWidget::pageIn);
+    connect(m_ui->dateEdit_2, &QDateEdit::dateChanged, this, &ThemeWidget::pageIn);
+
+    // The window shows up empty, the trainings are read on a worker thread.
+    // Nothing can be saved before they are there.
+    m_ui->SaveTrainingButton->setEnabled(false);
+    m_ui->pushButton->setEnabled(false);
+    m_ui->ImportButton->setEnabled(false);
+    m_ui->ProposePlanButton->setEnabled(false);
+    m_ui->ApplyPlanButton->setEnabled(false);
+    connect(&mTrainingsWatcher, &QFutureWatcher<QSharedPointer<LoadedTrainings>>::finished, this, &ThemeWidget::trainingsLoaded);
+    connect(&mDerivedWatcher, &QFutureWatcher<QSharedPointer<DerivedSeries>>::finished, this, &ThemeWidget::derivedLoaded);
+    connect(&mImportWatcher, &QFutureWatcher<std::vector<ActivitySummary>>::finished, this, &ThemeWidget::activitiesImported);
+    connect(&mPlanWatcher, &QFutureWatcher<std::vector<PlanCandidate>>::finished, this, &ThemeWidget::planProposed);
+    // Only the season of the current week is read before the window shows up
+    const QDate monday = today.addDays(1 - today.dayOfWeek());
+    mTrainingsWatcher.setFuture(QtConcurrent::run([this, monday]() { return loadTrainings(*mBackend, monday, monday.addDays(6)); }));
+
+    // Timings of the traced stages, not part of the regular UI
+    mPerfPanel = new PerfPanel(this);
+    QShortcut *perf_shortcut = new QShortcut(QKeySequence("Ctrl+Shift+P"), this);
+    connect(perf_shortcut, &QShortcut::activated, this, [this]() { mPerfPanel->setVisible(!mPerfPanel->isVisible()); });
 
     updateUI();
 }
 
 ThemeWidget::~ThemeWidget()
 {
+    mTrainingsWatcher.waitForFinished();
+    mDerivedWatcher.waitForFinished();
+    mPlanWatcher.waitForFinished();
     delete m_ui;
 }
 
+void ThemeWidget::paintEvent(QPaintEvent *event)
+{
+    if (!mPainted) {
+        mPainted = true;
+        LOG_INFO("Time to first paint: "<<mStartup.elapsed()<<" ms");
+    }
+    QWidget::paintEvent(event);
+}
+
+void ThemeWidget::trainingsLoaded()
+{
+    TRACE_SCOPE("ui.trainings_loaded");
+    QSharedPointer<LoadedTrainings> loaded = mTrainingsWatcher.result();
+    mTrainings = std::move(loaded->trainings);
+    mTrainings.takeChanges();
+    mIndex = std::move(loaded->index);
+    mPartitions = std::move(loaded->partitions);
+    mLoaded = true;
+    // The date pickers may have moved meanwhile
+    pageIn(m_ui->dateEdit->date());
+    pageIn(m_ui->dateEdit_2->date());
+
+    // The current week only needs the trainings and the index
+    mWeekModel->reload();
+    mCalendarModel->reload();
+    updateMyWeek();
+    m_ui->SaveTrainingButton->setEnabled(true);
+    m_ui->pushButton->setEnabled(true);
+    LOG_INFO("Trainings loaded: "<<mTrainings.size()<<" days of "<<mPartitions.years().size()<<" seasons, after "<<mStartup.elapsed()<<" ms");
+    deriveHistory();
+}
+
+void ThemeWidget::deriveHistory()
+{
+    // The series span the whole history, which the store does not hold: they
+    // are summed from the backend on a worker thread, the edits made meanwhile
+    // are applied by refresh() once they are there. So one on its way is enough.
+    if (mDerivedWatcher.isRunning())
+        return;
+    mDerived = false;
+    mDerivedWatcher.setFuture(QtConcurrent::run([this, samples = mSamples.directory()]() {
+        return deriveSeries(*mBackend, samples);
+    }));
+}
+
+void ThemeWidget::pageIn(const QDate &date)
+{
+    // Until trainingsLoaded() the store is filled by the loading thread
+    if (!mLoaded || !date.isValid())
+        return;
+    // The whole week, its summary is refreshed on edits
+    const QDate monday = date.addDays(1 - date.dayOfWeek());
+    if (!mPartitions.ensure(*mBackend, mTrainings, monday, monday.addDays(6)))
+        return;
+    mIndex.build(mTrainings);
+    mCalendarModel->reload();
+    mWeekModel->reload();
+}
+
+void ThemeWidget::derivedLoaded()
+{
+    TRACE_SCOPE("ui.derived_loaded");
+    QSharedPointer<DerivedSeries> derived = mDerivedWatcher.result();
+    mWeeks = std::move(derived->weeks);
+    // Their categories become codes of the store, like the weeks refreshed later
+    for (TrainingWeek &week: mWeeks)
+        week.category = mTrainings.intern(derived->strings.text(week.category));
+    mFatigue = std::move(derived->fatigue);
+    mFitness = std::move(derived->fitness);
+    mTss = std::move(derived->tss);
+    mTssFirstDay = derived->first_day;
+    mSamples = std::move(derived->samples);
+    mSeasonBests = std::move(derived->season_bests);
+    mForm.invalidateAll();
+    mDerived = true;
+    // Imports add to the season bests, which come with the history
+    m_ui->ImportButton->setEnabled(true);
+    // Plans start from the whole history
+    m_ui->ProposePlanButton->setEnabled(!mPlanWatcher.isRunning());
+
+    updateCharts();
+    updateForm();
+    LOG_INFO("History loaded: "<<mWeeks.size()<<" weeks, "<<derived->errors.size()<<" errors, after "<<mStartup.elapsed()<<" ms");
+    refresh();
+}
+
 /*
 QChart *ThemeWidget::createAreaChart() const
 {
@@ -446,151 +446,152 @@ QChart *ThemeWidget::createSplineChart() const
 }
 */
 
-QChart *ThemeWidget::createScatterChart() const
-{
-    // scatter chart
-    QChart *chart = new QChart();
-    chart->setTitle("Distance per week");
+size_t ThemeWidget::updateCharts() {
+    TRACE_SCOPE("ui.update_charts");
+    // Weeks are drawn at their monday
+    std::vector<QPointF> km, tss, hours;
+    km.reserve(mWeeks.size());
+    tss.reserve(mWeeks.size());
+    hours.reserve(mWeeks.size());
+    if (!mWeeks.empty())
+        weekPoints(mWeeks, weekStart(mWeeks.front()).toJulianDay(), weekStart(mWeeks.back()).toJulianDay(), km, tss, hours);
+    size_t points = 3*mWeeks.size();
+    mWeekChart->setPoints(WeekKm, std::move(km));
+    mWeekChart->setPoints(WeekTSS, std::move(tss));
+    mWeekChart->setPoints(WeekHours, std::move(hours));
+
+    // The load series span the same days, fitness being the longest
+    std::vector<QPointF> fatigue, fitness, form;
+    const qint64 first = mFitness.firstDay();
+    const size_t count = mFitness.size();
+    loadPoints(mFatigue, mFitness, mForm, first, first + qint64(count) - 1, fatigue, fitness, form);
+    points += 3*count;
+    mLoadChart->setPoints(LoadATL, std::move(fatigue));
+    mLoadChart->setPoints(LoadCTL, std::move(fitness));
+    mLoadChart->setPoints(LoadTSB, std::move(form));
+    points += updateProjection();
+    return points;
+}
 
-    QScatterSeries *serie = new QScatterSeries(chart);
-    serie->setName(QString("Km"));
-    for (const TrainingWeek &tmp : mWeeks) {
-        serie->append(QPoint(tmp.week_number, tmp.sum_km)); // TODO handle many years
-        std::cout<<"Week "<<tmp.week_number<<": "<<tmp.sum_km<<"km"<<std::endl;
+size_t ThemeWidget::updateChartRange(qint64 from, qint64 to) {
+    TRACE_SCOPE("ui.update_chart_range");
+    // The weeks of the changed days
+    const qint64 first_monday = from - from % 7;
+    const qint64 last_monday = to - to % 7;
+    std::vector<QPointF> km, tss, hours;
+    weekPoints(mWeeks, first_monday, last_monday, km, tss, hours);
+    size_t points = 3*km.size();
+    const double week_from = QDate::fromJulianDay(first_monday).startOfDay().toMSecsSinceEpoch();
+    const double week_to = QDate::fromJulianDay(last_monday).startOfDay().toMSecsSinceEpoch();
+    mWeekChart->replacePoints(WeekKm, week_from, week_to, km);
+    mWeekChart->replacePoints(WeekTSS, week_from, week_to, tss);
+    mWeekChart->replacePoints(WeekHours, week_from, week_to, hours);
+
+    // A day weighs on the loads of the taps() days after it
+    const qint64 load_to = to + qint64(mFitness.taps());
+    std::vector<QPointF> fatigue, fitness, form;
+    if (mFitness.size() > 0) {
+        const qint64 first = std::max(from, mFitness.firstDay());
+        const qint64 last = std::min(load_to, mFitness.firstDay() + qint64(mFitness.size()) - 1);
+        loadPoints(mFatigue, mFitness, mForm, first, last, fatigue, fitness, form);
     }
-    chart->addSeries(serie);
+    points += 3*fatigue.size();
+    mLoadChart->replacePoints(LoadATL, dayX(from), dayX(load_to), fatigue);
+    mLoadChart->replacePoints(LoadCTL, dayX(from), dayX(load_to), fitness);
+    mLoadChart->replacePoints(LoadTSB, dayX(from), dayX(load_to), form);
+
+    // The plan starts from the loads of tomorrow and follows the objectives
+    if (load_to >= mProjection.first_day)
+        points += updateProjection();
+    return points;
+}
 
-    chart->createDefaultAxes();
-    //chart->axes(Qt::Horizontal).first()->setRange(0, m_valueMax);
-    //chart->axes(Qt::Vertical).first()->setRange(0, m_valueCount);
-    // Add space to label to add space between labels and axis
-    QValueAxis *axisY = qobject_cast<QValueAxis*>(chart->axes(Qt::Vertical).first());
-    Q_ASSERT(axisY);
-    axisY->setLabelFormat("%.1f  ");
-    return chart;
+std::vector<double> ThemeWidget::plannedTss(qint64 start, qint64 end) const {
+    // The objectives of the days in the store, the seasons paged in
+    std::vector<double> plan(size_t(std::max<qint64>(end - start, 0)), 0.0);
+    mTrainings.copyColumn(TrainingStore::TSSObjective, start, plan.size(), plan.data());
+    return plan;
 }
 
-QColor computeColor(double done, double todo) {
-    int red = 255*(1-done/todo);
-    int green = 255*done/todo;
-    red = (red<0)?0: red;
-    red = (red>255)?255: red;
-    green = (green<0)?0: green;
-    green = (green>255)?255: green;
-    return QColor(red, green, 0, 127);
-}
-
-void ThemeWidget::updateCalendar() {
-    m_ui->CalendarWidget->setRowCount(mTrainings.size());
-    size_t item_count = 0;
-    m_ui->CalendarWidget->clearContents();
-    QTableWidgetItem *test;
-    for (auto it = mTrainings.begin(); it!= mTrainings.end(); it++) {
-        m_ui->CalendarWidget->setItem(item_count, 0, new QTableWidgetItem(it->date.toString()));
-        m_ui->CalendarWidget->setItem(item_count, 1, new QTableWidgetItem(it->weather));
-        m_ui->CalendarWidget->setItem(item_count, 2, new QTableWidgetItem(it->training));
-        m_ui->CalendarWidget->setItem(item_count, 3, new QTableWidgetItem(it->daily_objective));
-        test = new QTableWidgetItem(QString::number(it->TSS));
-        test->setBackgroundColor(computeColor(it->TSS, it->TSS_objective));
-        m_ui->CalendarWidget->setItem(item_count, 4, test);
-        m_ui->CalendarWidget->setItem(item_count, 5, new QTableWidgetItem(QString::number(it->TSS_objective)));
-        test =  new QTableWidgetItem(QString::number(it->Km_per_day));
-        test->setBackgroundColor(computeColor(it->Km_per_day, it->km_per_week_objective));
-        m_ui->CalendarWidget->setItem(item_count, 6, test);
-        m_ui->CalendarWidget->setItem(item_count, 7, new QTableWidgetItem(QString::number(it->km_per_week_objective)));
-        test =  new QTableWidgetItem(QString::number(it->feeling));
-        test->setBackgroundColor(computeColor(it->feeling, 6));
-        m_ui->CalendarWidget->setItem(item_count, 8, test);
-        test =  new QTableWidgetItem(QString::number(it->hour));
-        test->setBackgroundColor(computeColor(it->hour, it->hour_objective));
-        m_ui->CalendarWidget->setItem(item_count, 9, test);
-        m_ui->CalendarWidget->setItem(item_count, 10, new QTableWidgetItem(QString::number(it->hour_objective)));
-        m_ui->CalendarWidget->setItem(item_count, 11, new QTableWidgetItem(it->muscu));
-        m_ui->CalendarWidget->setItem(item_count, 12, new QTableWidgetItem(it->muscu_objective));
-        item_count++;
+size_t ThemeWidget::updateProjection() {
+    TRACE_SCOPE("ui.update_projection");
+    // From tomorrow on, over the proposal not applied yet or else the
+    // objectives up to the last planned day or the date picked
+    const qint64 start = QDate::currentDate().toJulianDay() + 1;
+    std::vector<double> plan;
+    if (!mProposal.empty() && mProposalStart == start) {
+        plan = mProposal;
+    } else {
+        mProposal.clear();
+        const qint64 last = mTrainings.isEmpty() ? 0 : mTrainings.lastDate().toJulianDay();
+        plan = plannedTss(start, std::max(last, m_ui->dateEdit->date().toJulianDay()) + 1);
     }
+    mProjection = projectPlan(mTss.data(), mTss.size(), mTssFirstDay, start, plan);
+
+    std::vector<QPointF> fatigue, fitness, form;
+    for (size_t i = 0; i < mProjection.size(); i++) {
+        const double x = dayX(start + i);
+        fatigue.emplace_back(x, mProjection.fatigue[i]);
+        fitness.emplace_back(x, mProjection.fitness[i]);
+        form.emplace_back(x, mProjection.form[i]);
+    }
+    mLoadChart->setPoints(LoadPlanATL, std::move(fatigue));
+    mLoadChart->setPoints(LoadPlanCTL, std::move(fitness));
+    mLoadChart->setPoints(LoadPlanTSB, std::move(form));
+    return 3*mProjection.size();
 }
 
 void ThemeWidget::updateMyWeek() {
+    TRACE_SCOPE("ui.update_my_week");
     QDate today = QDate::currentDate();
 
     m_ui->dateEdit_2->setDate(today);
     m_ui->todayLabel->setText(today.toString());
 
-    // Search training of the week
-    size_t count = 0;
-    m_ui->WeekWidget->clearContents();
-    double sum_km_done = 0;
-    double sum_km_objective = 0;
-    double sum_hour_done = 0;
-    double sum_hour_objective = 0;
-    double sum_tss_done = 0;
-    double sum_tss_objective = 0;
-    QTableWidgetItem *test;
-    for (auto it = mTrainings.begin(); it!= mTrainings.end(); it++) {
-        if (today.weekNumber() == it->date.weekNumber()) {
-            sum_km_done += it->Km_per_day;
-            sum_km_objective += it->km_per_week_objective;
-            sum_hour_done += it->hour;
-            sum_hour_objective += it->hour_objective;
-            sum_tss_done += it->TSS;
-            sum_tss_objective += it->TSS_objective;
-            m_ui->WeekWidget->setItem(count, 0, new QTableWidgetItem(it->date.toString()));
-            m_ui->WeekWidget->setItem(count, 1, new QTableWidgetItem(it->weather));
-            m_ui->WeekWidget->setItem(count, 2, new QTableWidgetItem(it->training));
-            m_ui->WeekWidget->setItem(count, 3, new QTableWidgetItem(it->daily_objective));
-            test = new QTableWidgetItem(QString::number(it->TSS));
-            test->setBackgroundColor(computeColor(it->TSS, it->TSS_objective));
-            m_ui->WeekWidget->setItem(count, 4, test);
-            m_ui->WeekWidget->setItem(count, 5, new QTableWidgetItem(QString::number(it->TSS_objective)));
-            test = new QTableWidgetItem(QString::number(it->Km_per_day));
-            test->setBackgroundColor(computeColor(it->Km_per_day, it->km_per_week_objective));
-            m_ui->WeekWidget->setItem(count, 6, test);
-            m_ui->WeekWidget->setItem(count, 7, new QTableWidgetItem(QString::number(it->km_per_week_objective)));
-            test =  new QTableWidgetItem(QString::number(it->feeling));
-            test->setBackgroundColor(computeColor(it->feeling, 6));
-            m_ui->WeekWidget->setItem(count, 8, test);
-            test = new QTableWidgetItem(QString::number(it->hour));
-            test->setBackgroundColor(computeColor(it->hour, it->hour_objective));
-            m_ui->WeekWidget->setItem(count, 9, test);
-            m_ui->WeekWidget->setItem(count, 10, new QTableWidgetItem(QString::number(it->hour_objective)));
-            m_ui->WeekWidget->setItem(count, 11, new QTableWidgetItem(it->muscu));
-            m_ui->WeekWidget->setItem(count, 12, new QTableWidgetItem(it->muscu_objective));
-            count++;
-            if (it->date == today) {
-                m_ui->label_12->setText(it->training);
-                m_ui->label_30->setText(it->daily_objective);
-
-                m_ui->label_13->setText(it->muscu_objective);
-                m_ui->label_32->setText(it->muscu);
-
-                m_ui->label_17->setText(QString::number(it->hour));
-                m_ui->label_14->setText(QString::number(it->hour_objective));
-
-                m_ui->label_18->setText(QString::number(it->Km_per_day));
-                m_ui->label_15->setText(QString::number(it->km_per_week_objective));
-
-                m_ui->label_19->setText(QString::number(it->TSS));
-                m_ui->label_16->setText(QString::number(it->TSS_objective));
-
-                m_ui->label_5->setText(it->weather);
-
-                if (it->hour_objective > 0)
-                    m_ui->progressBar->setValue(100*it->hour/it->hour_objective);
-                else
-                     m_ui->progressBar->setValue(100);
-
-                if (it->km_per_week_objective > 0)
-                    m_ui->progressBar_2->setValue(100*it->Km_per_day/it->km_per_week_objective);
-                else
-                    m_ui->progressBar_2->setValue(100);
-
-                if (it->TSS_objective > 0)
-                    m_ui->progressBar_3->setValue(100*it->TSS/it->TSS_objective);
-                else
-                    m_ui->progressBar_3->setValue(100);
-            }
-        }
+    const QDate monday = today.addDays(1 - today.dayOfWeek());
+    const QDate sunday = monday.addDays(6);
+    mWeekModel->setDateRange(monday, sunday);
+    const TrainingWeek week = rangeSummary(mIndex, monday, sunday);
+    double sum_km_done = week.sum_km;
+    double sum_km_objective = week.sum_km_objective;
+    double sum_hour_done = week.sum_hour;
+    double sum_hour_objective = week.sum_hour_objective;
+    double sum_tss_done = week.sum_tss;
+    double sum_tss_objective = week.sum_tss_objective;
+
+    if (mTrainings.contains(today)) {
+        const TrainingItem it = mTrainings.value(today);
+        m_ui->label_12->setText(it.training);
+        m_ui->label_30->setText(it.daily_objective);
+
+        m_ui->label_13->setText(it.muscu_objective);
+        m_ui->label_32->setText(it.muscu);
+
+        m_ui->label_17->setText(QString::number(it.hour));
+        m_ui->label_14->setText(QString::number(it.hour_objective));
+
+        m_ui->label_18->setText(QString::number(it.Km_per_day));
+        m_ui->label_15->setText(QString::number(it.km_per_week_objective));
+
+        m_ui->label_19->setText(QString::number(it.TSS));
+        m_ui->label_16->setText(QString::number(it.TSS_objective));
+
+        m_ui->label_5->setText(it.weather);
+
+        if (it.hour_objective > 0)
+            m_ui->progressBar->setValue(100*it.hour/it.hour_objective);
+        else
+             m_ui->progressBar->setValue(100);
+
+        if (it.km_per_week_objective > 0)
+            m_ui->progressBar_2->setValue(100*it.Km_per_day/it.km_per_week_objective);
+        else
+            m_ui->progressBar_2->setValue(100);
+
+        if (it.TSS_objective > 0)
+            m_ui->progressBar_3->setValue(100*it.TSS/it.TSS_objective);
+        else
+            m_ui->progressBar_3->setValue(100);
     }
 
     m_ui->progressBar_6->setValue(100*sum_km_done/sum_km_objective);
@@ -607,184 +608,317 @@ void ThemeWidget::updateMyWeek() {
 
 void ThemeWidget::updateUI()
 {
-    updateWeekSummary();
-    updateCalendar();
     updateMyWeek();
+    updateForm();
 }
 
-void ThemeWidget::saveTrainingPlan()
+void ThemeWidget::scheduleRefresh()
 {
-    std::cout<<"Add item in training plans"<<std::endl;
+    // Edits made in the same event loop turn share one refresh
+    if (mRefreshPending)
+        return;
+    mRefreshPending = true;
+    QTimer::singleShot(0, this, &ThemeWidget::refresh);
+}
 
-    std::vector<TrainingItem>::iterator dayfound = mTrainings.end();
-    std::vector<TrainingItem>::iterator inserthere = mTrainings.end();
+void ThemeWidget::refresh()
+{
+    TRACE_SCOPE("ui.refresh");
+    mRefreshPending = false;
+    // Still loading: the changes wait in the store until derivedLoaded()
+    if (!mDerived)
+        return;
+    const TrainingChanges changes = mTrainings.takeChanges();
+    if (changes.isEmpty())
+        return;
 
-    // Search for an other training on the same day
-    for (auto it = mTrainings.begin(); it!= mTrainings.end(); it++) {
-        if (it->date == m_ui->dateEdit->date()) {
-            // TODO: ask if we want to override
-            dayfound = it;
-            break;
+    QElapsedTimer timer;
+    timer.start();
+    RefreshCounters counters = {};
+    if (changes.reset) {
+        reloadAll(counters);
+    } else {
+        counters.days = changes.days.size();
+        qint64 monday = -1;
+        for (qint32 day: changes.days) {
+            const QDate date = QDate::fromJulianDay(day);
+            mIndex.update(mTrainings, date);
+            setTss(day, mTrainings.dayValue(TrainingStore::TSS, day));
+            if (mCalendarModel->dayChanged(date))
+                counters.rows++;
+            if (mWeekModel->dayChanged(date))
+                counters.rows++;
         }
+        // Days are sorted, the index is up to date: one pass per week
+        for (qint32 day: changes.days) {
+            if (day - day % 7 == monday)
+                continue;
+            monday = day - day % 7;
+            ::updateWeekSummary(mWeeks, mTrainings, mIndex, QDate::fromJulianDay(day));
+            counters.weeks++;
+        }
+        counters.load_days = updateLoad(changes.days.front(), changes.days.back());
+        counters.chart_points = updateChartRange(changes.days.front(), changes.days.back());
     }
-    if (dayfound == mTrainings.end()) {
-        for (auto it = mTrainings.begin(); it!= mTrainings.end() && it->date.daysTo(m_ui->dateEdit->date()) > 0; it++)
-            inserthere = it+1;
-        TrainingItem tmp = blankDay();
-        dayfound = mTrainings.insert(inserthere, tmp);
-    }
-
-    std::cout<<"Setting new day"<<std::endl;
-    dayfound->date = m_ui->dateEdit->date();
-    dayfound->weather = m_ui->comboBox->currentText();
-    dayfound->daily_objective = m_ui->textEdit->toPlainText();
-    dayfound->TSS_objective = m_ui->spinBox->value();
-    dayfound->km_per_week_objective = m_ui->spinBox_2->value();
-    dayfound->hour_objective = m_ui->doubleSpinBox->value();
+    updateUI();
+    counters.elapsed_us = timer.nsecsElapsed()/1000;
+    LOG_DEBUG("Refresh: "<<counters.days<<" days, "<<counters.weeks<<" weeks, "<<counters.rows<<" rows, "
+              <<counters.load_days<<" load values, "<<counters.chart_points<<" points in "<<counters.elapsed_us<<" us");
+}
 
-    orderVector();
+void ThemeWidget::reloadAll(RefreshCounters &counters)
+{
+    TRACE_SCOPE("ui.reload_all");
+    mIndex.build(mTrainings);
+    mCalendarModel->reload();
+    mWeekModel->reload();
+    counters.days = mTrainings.slotCount();
+    counters.rows = mTrainings.size();
+    // The weeks, the load and the charts follow with derivedLoaded()
+    deriveHistory();
 }
 
-void ThemeWidget::orderVector()
+void ThemeWidget::saveTrainingPlan()
 {
-   int i=0;
-    while(i>=0 && i<mTrainings.size()-1) {
-        if (mTrainings[i].date.daysTo(mTrainings[i+1].date) < 0) {
-            std::cout<<"Training order error: "<<mTrainings[i].date.toString().toStdString()<<" is after "<<mTrainings[i+1].date.toString().toStdString()<<std::endl;
-            TrainingItem tmp = mTrainings[i+1];
-            mTrainings[i+1] = mTrainings[i];
-            mTrainings[i] = tmp;
-            i-=2;
-            if (i<0)
-                i=0;
-        } else {
-            i++;
-        }
-    }
+    TRACE_SCOPE("ui.save_training_plan");
+    LOG_DEBUG("Add item in training plans");
+
+    // TODO: ask if we want to override an other training on the same day
+    pageIn(m_ui->dateEdit->date());
+    TrainingItem day = mTrainings.value(m_ui->dateEdit->date());
+
+    LOG_DEBUG("Setting new day");
+    day.weather = m_ui->comboBox->currentText();
+    day.daily_objective = m_ui->textEdit->toPlainText();
+    day.TSS_objective = m_ui->spinBox->value();
+    day.km_per_week_objective = m_ui->spinBox_2->value();
+    day.hour_objective = m_ui->doubleSpinBox->value();
+
+    mTrainings.insert(day);
+    mBackend->save(day);
     saveToFile();
-    updateUI();
+    scheduleRefresh();
 }
 
 void ThemeWidget::saveWorkout()
 {
-    std::cout<<"Activity saved into training plans"<<std::endl;
-
-    std::vector<TrainingItem>::iterator dayfound = mTrainings.end();
-    std::vector<TrainingItem>::iterator inserthere = mTrainings.end();
-
-    // Search for an other training on the same day
-    for (auto it = mTrainings.begin(); it!= mTrainings.end(); it++) {
-        if (it->date == m_ui->dateEdit_2->date()) {
-            dayfound = it;
-            break;
-        }
-    }
-    if (dayfound == mTrainings.end()) {
-        for (auto it = mTrainings.begin(); it!= mTrainings.end() && it->date.daysTo(m_ui->dateEdit_2->date()) > 0; it++)
-            inserthere = it+1;
-        TrainingItem tmp = blankDay();
-        dayfound = mTrainings.insert(inserthere, tmp);
-    }
+    TRACE_SCOPE("ui.save_workout");
+    LOG_DEBUG("Activity saved into training plans");
 
-    std::cout<<"Add training"<<std::endl;
-    dayfound->date = m_ui->dateEdit_2->date(); // make sure of the date
+    pageIn(m_ui->dateEdit_2->date());
+    TrainingItem day = mTrainings.value(m_ui->dateEdit_2->date());
 
-    dayfound->weather = m_ui->WeatherCombo->currentText();
+    LOG_DEBUG("Add training");
+    day.weather = m_ui->WeatherCombo->currentText();
 
-    dayfound->feeling = m_ui->FeelingSpinBox->value(); // Overwrite feeling
+    day.feeling = m_ui->FeelingSpinBox->value(); // Overwrite feeling
 
     if (m_ui->checkBox->isChecked()) {
-        dayfound->training = m_ui->CommentLineEdit->text();
-        dayfound->TSS = m_ui->TSSSpinBox->value();
-        dayfound->Km_per_day = m_ui->KmDoubleSpinBox->value();
-        dayfound->hour = m_ui->DurationDoubleSpinBox->value();
-        dayfound->muscu = m_ui->MuscuLineEdit->text();
+        day.training = m_ui->CommentLineEdit->text();
+        day.TSS = m_ui->TSSSpinBox->value();
+        day.Km_per_day = m_ui->KmDoubleSpinBox->value();
+        day.hour = m_ui->DurationDoubleSpinBox->value();
+        day.muscu = m_ui->MuscuLineEdit->text();
     } else {
-        if(dayfound->training.size() > 0)
-            dayfound->training.append("; ");
+        if(day.training.size() > 0)
+            day.training.append("; ");
 
-        dayfound->training.append(m_ui->CommentLineEdit->text());
+        day.training.append(m_ui->CommentLineEdit->text());
 
-        dayfound->TSS += m_ui->TSSSpinBox->value();
+        day.TSS += m_ui->TSSSpinBox->value();
 
-        dayfound->Km_per_day += m_ui->KmDoubleSpinBox->value();
+        day.Km_per_day += m_ui->KmDoubleSpinBox->value();
 
-        dayfound->hour += m_ui->DurationDoubleSpinBox->value();
+        day.hour += m_ui->DurationDoubleSpinBox->value();
 
-        if(dayfound->muscu.size() > 0)
-            dayfound->muscu.append("; ");
-        dayfound->muscu.append(m_ui->MuscuLineEdit->text());
+        if(day.muscu.size() > 0)
+            day.muscu.append("; ");
+        day.muscu.append(m_ui->MuscuLineEdit->text());
     }
-    orderVector();
+    mTrainings.insert(day);
+    mBackend->save(day);
+    saveToFile();
+    scheduleRefresh();
 }
 
-void ThemeWidget::saveToFile()
+void ThemeWidget::importActivities()
 {
-    saveTrainingsToFile("test_training.csv", mTrainings);
+    const QStringList files = QFileDialog::getOpenFileNames(this, "Import activities", QString(), "Activities (*.fit *.tcx *.gpx)");
+    if (files.isEmpty() || mImportWatcher.isRunning())
+        return;
+
+    QSettings settings;
+    AthleteThresholds thresholds;
+    thresholds.ftp = settings.value("athlete/ftp", thresholds.ftp).toDouble();
+    thresholds.threshold_hr = settings.value("athlete/threshold_hr", thresholds.threshold_hr).toDouble();
+
+    LOG_INFO("Importing "<<files.size()<<" activities");
+    m_ui->ImportButton->setEnabled(false);
+    QDir().mkpath(mSamples.directory());
+    mImportWatcher.setFuture(QtConcurrent::run([files, thresholds, samples = SampleStore(mSamples.directory())]() {
+        return ::importActivities(files, thresholds, &samples);
+    }));
 }
 
-void ThemeWidget::updateWeekSummary()
+void ThemeWidget::activitiesImported()
 {
-    mWeeks.clear();
-    TrainingWeek tmp = blankWeek();
-    for (auto it = mTrainings.begin(); it!= mTrainings.end(); it++) {
-        if (tmp.year == it->date.year() && tmp.week_number == it->date.weekNumber()) {
-            tmp.sum_hour += it->hour;
-            tmp.sum_tss += it->TSS;
-            tmp.sum_km += it->Km_per_day;
-            tmp.sum_hour_objective += it->hour_objective;
-            tmp.sum_tss_objective += it->TSS_objective;
-            tmp.sum_km_objective += it->km_per_week_objective;
-            if (!it->category.isEmpty())
-                tmp.category = it->category;
-        } else {
-            if (tmp.sum_hour != 0 || tmp.sum_km != 0 || tmp.sum_tss != 0)
-                mWeeks.push_back(tmp);
-            tmp = blankWeek();
-            tmp.week_number = it->date.weekNumber();
-            tmp.year = it->date.year();
-            tmp.month = it->date.month();
-            tmp.sum_hour += it->hour;
-            tmp.sum_tss += it->TSS;
-            tmp.sum_km += it->Km_per_day;
-            tmp.sum_hour_objective += it->hour_objective;
-            tmp.sum_tss_objective += it->TSS_objective;
-            tmp.sum_km_objective += it->km_per_week_objective;
-            if (!it->category.isEmpty())
-                tmp.category = it->category;
+    TRACE_SCOPE("ui.activities_imported");
+    const std::vector<ActivitySummary> activities = mImportWatcher.result();
+    std::set<int> seasons;
+    for (const ActivitySummary &activity: activities) {
+        if (!activity.ok) {
+            LOG_ERROR(activity.name.toStdString()<<": "<<activity.error.toStdString());
+            continue;
+        }
+        // Like a workout added without "Overwrite"
+        pageIn(activity.date);
+        TrainingItem day = mTrainings.value(activity.date);
+        addActivity(day, activity);
+        mTrainings.insert(day);
+        mBackend->save(day);
+        if (!activity.sample_file.isEmpty())
+            mSamples.add(activity.date, activity.sample_file);
+        if (!activity.power_curve.empty()) {
+            mSeasonBests.add(activity.date.year(), activity.power_curve);
+            seasons.insert(activity.date.year());
         }
     }
+    for (int season: seasons)
+        printSeasonBests(season);
+    m_ui->ImportButton->setEnabled(true);
+    saveToFile();
+    scheduleRefresh();
 }
 
-void ThemeWidget::updateFatigue() {
-    mFatigue.clear();
-    if (mTrainings.size() <= sizeof(fatigue_coef)/sizeof(double)) {
-        std::cout<<"Too few data to compute Fatigue ("<<sizeof(fatigue_coef)/sizeof(double)<<" required, "<<mTrainings.size()<<" available)"<<std::endl;
+void ThemeWidget::printSeasonBests(int season) const
+{
+    static const int durations[] = {5, 60, 300, 1200, 3600};
+    const std::vector<float> &curve = mSeasonBests.curve(season);
+    if (!logEnabled(LogLevel::Info))
         return;
+    std::ostringstream line;
+    line<<"Season "<<season<<" best power:";
+    for (int duration: durations) {
+        if (size_t(duration) <= curve.size())
+            line<<" "<<duration<<" s "<<std::lround(curve[duration - 1])<<" W";
     }
-    size_t count = 0;
-    QDate current_date;
-    double current_fatigue;
-    for (auto it = mTrainings.begin(); it!= mTrainings.end(); it++) {
-        if (count > sizeof(fatigue_coef)/sizeof(double)) {
-            current_date = it->date;
-            current_fatigue = 0;
-            std::vector<TrainingItem>::iterator it2 = it-sizeof(fatigue_coef)/sizeof(double);
-            for(int i =sizeof(fatigue_coef)/sizeof(double)-1; i>=0; i--) {
-                current_fatigue += fatigue_coef[i]*it2->TSS;
-                it2++;
-            }
-            mFatigue.push_back(std::pair<QDate, double>(current_date,current_fatigue));
-            std::cout<<"Fatigue for "<<current_date.toString().toStdString()<<": "<<current_fatigue<<std::endl;
-        }
-        count++;
-    }
+    LOG_INFO(line.str());
+}
+
+void ThemeWidget::saveToFile()
+{
+    TRACE_SCOPE("ui.save_to_file");
+    // Edits are already saved, only fold the CSV journal into its snapshot
+    // once it has grown enough
+    if (mBackend->needsCompaction())
+        mBackend->compact();
 }
 
-void ThemeWidget::updateFitness() {
+size_t ThemeWidget::updateLoad(qint64 from, qint64 to) {
+    TRACE_SCOPE("ui.update_load");
+    size_t computed = mFatigue.update(mTss.data(), mTss.size(), mTssFirstDay, from, to);
+    computed += mFitness.update(mTss.data(), mTss.size(), mTssFirstDay, from, to);
+    // Fitness has the longest memory
+    mForm.invalidate(from + 1, to + mFitness.taps());
+    return computed;
+}
 
+void ThemeWidget::setTss(qint64 day, double tss) {
+    // An edit before the first day or after the last one extends the history
+    if (mTss.empty())
+        mTssFirstDay = day;
+    if (day < mTssFirstDay) {
+        mTss.insert(mTss.begin(), mTssFirstDay - day, 0.0);
+        mTssFirstDay = day;
+    }
+    if (day >= mTssFirstDay + qint64(mTss.size()))
+        mTss.resize(day - mTssFirstDay + 1, 0.0);
+    mTss[day - mTssFirstDay] = tss;
 }
 
 void ThemeWidget::updateForm() {
+    TRACE_SCOPE("ui.update_form");
+    const qint64 day = m_ui->dateEdit->date().toJulianDay();
+    if (mDerived && day > QDate::currentDate().toJulianDay()) {
+        // Ahead of today the form comes from what is planned
+        if (day >= mProjection.first_day + qint64(mProjection.size()) || day < mProjection.first_day)
+            updateProjection();
+        m_ui->FormLabel->setText(QString::number(mProjection.formAt(day), 'f', 1));
+        return;
+    }
+    // Only the cached blocks around that date are computed
+    const double form = mForm.at(day);
+    m_ui->FormLabel->setText(QString::number(form, 'f', 1));
+}
+
+void ThemeWidget::proposePlan()
+{
+    if (!mDerived || mPlanWatcher.isRunning())
+        return;
+    QSettings settings;
+    PlanGoal goal;
+    goal.start = QDate::currentDate().toJulianDay() + 1;
+    goal.race_day = m_ui->dateEdit->date().toJulianDay();
+    goal.target_form = m_ui->RaceFormSpinBox->value();
+    goal.max_week_tss = m_ui->WeekLimitSpinBox->value();
+    goal.max_ramp = settings.value("plan/max_ramp", goal.max_ramp).toDouble();
+    if (goal.race_day <= goal.start) {
+        m_ui->PlanLabel->setText("Pick a race date after tomorrow");
+        return;
+    }
+
+    LOG_INFO("Searching plans to "<<m_ui->dateEdit->date().toString().toStdString()<<", TSB "<<goal.target_form);
+    m_ui->ProposePlanButton->setEnabled(false);
+    m_ui->ApplyPlanButton->setEnabled(false);
+    m_ui->PlanLabel->setText("Searching...");
+    mPlanWatcher.setFuture(QtConcurrent::run([tss = mTss, first_day = mTssFirstDay, goal]() {
+        return searchPlans(tss.data(), tss.size(), first_day, goal);
+    }));
+}
+
+void ThemeWidget::planProposed()
+{
+    TRACE_SCOPE("ui.plan_proposed");
+    const std::vector<PlanCandidate> candidates = mPlanWatcher.result();
+    m_ui->ProposePlanButton->setEnabled(mDerived);
+    if (candidates.empty()) {
+        m_ui->PlanLabel->setText("No plan within the weekly limit");
+        return;
+    }
+    const PlanCandidate &best = candidates.front();
+    mProposal = best.tss;
+    mProposalStart = QDate::currentDate().toJulianDay() + 1;
+    m_ui->PlanLabel->setText(QString("TSB %1, CTL %2: up to %3 TSS a week, %4 days of taper at %5 %")
+                             .arg(best.form, 0, 'f', 1)
+                             .arg(best.fitness, 0, 'f', 1)
+                             .arg(std::lround(best.shape.peak))
+                             .arg(best.shape.taper_days)
+                             .arg(std::lround(100*best.shape.taper)));
+    m_ui->ApplyPlanButton->setEnabled(true);
+    updateProjection();
+    updateForm();
+}
 
+void ThemeWidget::applyPlan()
+{
+    TRACE_SCOPE("ui.apply_plan");
+    if (mProposal.empty())
+        return;
+    // The proposal becomes the TSS objectives of its days
+    for (size_t i = 0; i < mProposal.size(); i++) {
+        const QDate date = QDate::fromJulianDay(mProposalStart + qint64(i));
+        const double tss = std::round(mProposal[i]);
+        pageIn(date);
+        if (tss == 0 && !mTrainings.contains(date))
+            continue;
+        TrainingItem day = mTrainings.value(date);
+        day.TSS_objective = tss;
+        mTrainings.insert(day);
+        mBackend->save(day);
+    }
+    LOG_INFO("Plan applied: "<<mProposal.size()<<" days");
+    mProposal.clear();
+    m_ui->ApplyPlanButton->setEnabled(false);
+    saveToFile();
+    scheduleRefresh();
 }
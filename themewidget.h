@@ -30,8 +30,24 @@
 #ifndef THEMEWIDGET_H
 #define THEMEWIDGET_H
 
+#include <memory>
+
 #include <QtWidgets/QWidget>
 #include <QtCharts/QChartGlobal>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QSharedPointer>
+
+#include "activityimport.h"
+#include "loadmodel.h"
+#include "powercurve.h"
+#include "samplestore.h"
+#include "trainingindex.h"
+#include "trainingbackend.h"
+#include "trainingloader.h"
+#include "trainingpartitions.h"
+#include "trainingplan.h"
+#include "trainingstore.h"
 
 QT_BEGIN_NAMESPACE
 class QComboBox;
@@ -52,6 +68,20 @@ QT_CHARTS_USE_NAMESPACE
 
 class TrainingItem;
 class TrainingWeek;
+class PerfPanel;
+class TimeChartView;
+class TrainingTableModel;
+
+// Work done by one refresh of the views
+class RefreshCounters {
+public:
+    size_t days;        // days changed in the store
+    size_t weeks;       // week summaries recomputed
+    size_t rows;        // table rows signalled to the views
+    size_t load_days;   // fatigue and fitness values recomputed
+    size_t chart_points;
+    qint64 elapsed_us;
+};
 
 class ThemeWidget: public QWidget
 {
@@ -60,16 +90,24 @@ public:
     explicit ThemeWidget(QWidget *parent = 0);
     ~ThemeWidget();
 
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
 private Q_SLOTS:
+    void trainingsLoaded();
+    void derivedLoaded();
+    void refresh();
     void updateUI();
     void saveTrainingPlan();
     void saveWorkout();
+    void importActivities();
+    void activitiesImported();
     void saveToFile();
-    void orderVector();
-    void updateWeekSummary();
-    void updateFatigue();
-    void updateFitness();
     void updateForm();
+    void pageIn(const QDate &date);
+    void proposePlan();
+    void planProposed();
+    void applyPlan();
 
 private:
     DataTable generateWeekDistanceData() const;
@@ -78,21 +116,52 @@ private:
     void populateLegendBox();
     void connectSignals();
     QChart *createLineChart() const;
-    QChart *createScatterChart() const;
     void updateMyWeek();
-    void updateCalendar();
+    void scheduleRefresh();
+    void reloadAll(RefreshCounters &counters);
+    void deriveHistory();
+    void setTss(qint64 day, double tss);
+    size_t updateLoad(qint64 from, qint64 to);
+    size_t updateCharts();
+    size_t updateChartRange(qint64 from, qint64 to);
+    std::vector<double> plannedTss(qint64 start, qint64 end) const;
+    size_t updateProjection();
+    void printSeasonBests(int season) const;
 
 private:
     int m_listCount;
     int m_valueMax;
     int m_valueCount;
     QList<QChartView *> m_charts;
-    QStringList mTableHeader;
-    std::vector<TrainingItem> mTrainings;
+    TrainingStore mTrainings;       // the seasons in mPartitions only
+    TrainingIndex mIndex;
+    TrainingPartitions mPartitions;
     std::vector<TrainingWeek> mWeeks;
-    std::vector<std::pair<QDate,double>> mFatigue;
-    std::vector<std::pair<QDate,double>> mFitness;
-    std::vector<std::pair<QDate,double>> mForm;
+    std::vector<double> mTss;       // TSS of every day of the history, from mTssFirstDay
+    qint64 mTssFirstDay;
+    LoadSeries mFatigue;
+    LoadSeries mFitness;
+    FormSeries mForm;
+    TrainingTableModel *mCalendarModel;
+    TrainingTableModel *mWeekModel;
+    TimeChartView *mWeekChart;
+    TimeChartView *mLoadChart;
+    PerfPanel *mPerfPanel;
+    bool mRefreshPending;
+    QFutureWatcher<QSharedPointer<LoadedTrainings>> mTrainingsWatcher;
+    QFutureWatcher<QSharedPointer<DerivedSeries>> mDerivedWatcher;
+    QFutureWatcher<std::vector<ActivitySummary>> mImportWatcher;
+    QFutureWatcher<std::vector<PlanCandidate>> mPlanWatcher;
+    std::vector<double> mProposal;  // TSS of the proposed plan, from mProposalStart
+    qint64 mProposalStart;
+    PlanProjection mProjection;     // loads from tomorrow, over the objectives or the proposal
+    bool mLoaded;       // the trainings are loaded
+    bool mDerived;      // the derived series are loaded
+    bool mPainted;
+    QElapsedTimer mStartup;
+    std::unique_ptr<TrainingBackend> mBackend;
+    SampleStore mSamples;
+    SeasonBests mSeasonBests;
 
     Ui_ThemeWidgetForm *m_ui;
 };
@@ -0,0 +1,225 @@
+#include "timechartview.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QtCharts/QDateTimeAxis>
+#include <QtCharts/QLineSeries>
+#include <QtCharts/QValueAxis>
+#include <QtCore/QDateTime>
+#include <QtCore/QTimer>
+#include <QtGui/QMouseEvent>
+#include <QtGui/QWheelEvent>
+
+#include "downsample.h"
+#include "trace.h"
+
+namespace {
+
+bool pointBefore(const QPointF &point, double x)
+{
+    return point.x() < x;
+}
+
+bool pointAfter(double x, const QPointF &point)
+{
+    return x < point.x();
+}
+
+} // namespace
+
+TimeChartView::TimeChartView(const QString &title, QWidget *parent):
+    QChartView(new QChart(), parent),
+    mAxisX(new QDateTimeAxis),
+    mAxisLeft(new QValueAxis),
+    mAxisRight(nullptr),
+    mFrom(0),
+    mTo(0),
+    mFitted(false),
+    mResamplePending(false),
+    mDragging(false)
+{
+    chart()->setTitle(title);
+    mAxisX->setFormat("MMM yyyy");
+    mAxisX->setTickCount(6);
+    chart()->addAxis(mAxisX, Qt::AlignBottom);
+    // Add space to label to add space between labels and axis
+    mAxisLeft->setLabelFormat("%.1f  ");
+    chart()->addAxis(mAxisLeft, Qt::AlignLeft);
+    setRenderHint(QPainter::Antialiasing);
+}
+
+int TimeChartView::addSeries(const QString &name, bool right)
+{
+    if (right && !mAxisRight) {
+        mAxisRight = new QValueAxis;
+        mAxisRight->setLabelFormat("%.1f");
+        chart()->addAxis(mAxisRight, Qt::AlignRight);
+    }
+    Series series;
+    series.line = new QLineSeries(chart());
+    series.line->setName(name);
+    series.axis = right ? mAxisRight : mAxisLeft;
+    chart()->addSeries(series.line);
+    series.line->attachAxis(mAxisX);
+    series.line->attachAxis(series.axis);
+    mSeries.push_back(series);
+    return int(mSeries.size()) - 1;
+}
+
+void TimeChartView::setPoints(int series, std::vector<QPointF> points)
+{
+    mSeries[series].points = std::move(points);
+    // The first data decides of the initial range, keep the user's one after
+    if (!mFitted)
+        showAll();
+    else
+        scheduleResample();
+}
+
+void TimeChartView::replacePoints(int series, double from, double to, const std::vector<QPointF> &points)
+{
+    std::vector<QPointF> &all = mSeries[series].points;
+    auto begin = std::lower_bound(all.begin(), all.end(), from, pointBefore);
+    auto end = std::upper_bound(begin, all.end(), to, pointAfter);
+    // Overwrite the points in place, the rest of the series does not move
+    // unless points are added or removed
+    const size_t kept = std::min(size_t(end - begin), points.size());
+    std::copy(points.begin(), points.begin() + kept, begin);
+    if (points.size() > kept)
+        all.insert(begin + kept, points.begin() + kept, points.end());
+    else
+        all.erase(begin + kept, end);
+    if (!mFitted)
+        showAll();
+    else
+        scheduleResample();
+}
+
+void TimeChartView::showAll()
+{
+    double from = 0;
+    double to = 0;
+    bool empty = true;
+    for (const Series &series: mSeries) {
+        if (series.points.empty())
+            continue;
+        from = empty ? series.points.front().x() : std::min(from, series.points.front().x());
+        to = empty ? series.points.back().x() : std::max(to, series.points.back().x());
+        empty = false;
+    }
+    if (empty)
+        return;
+    mFitted = true;
+    setRange(from, to);
+}
+
+void TimeChartView::resizeEvent(QResizeEvent *event)
+{
+    QChartView::resizeEvent(event);
+    // One point per pixel: the width decides of the sampling
+    scheduleResample();
+}
+
+void TimeChartView::wheelEvent(QWheelEvent *event)
+{
+    if (mTo <= mFrom) {
+        QChartView::wheelEvent(event);
+        return;
+    }
+    // Zoom around the date under the cursor, 120 is one notch
+    const QRectF plot = chart()->plotArea();
+    const QPointF position = chart()->mapFromScene(mapToScene(event->position().toPoint()));
+    const double ratio = std::min(std::max((position.x() - plot.left())/plot.width(), 0.0), 1.0);
+    const double center = mFrom + ratio*(mTo - mFrom);
+    const double factor = std::pow(0.999, event->angleDelta().y());
+    setRange(center - (center - mFrom)*factor, center + (mTo - center)*factor);
+    event->accept();
+}
+
+void TimeChartView::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton) {
+        QChartView::mousePressEvent(event);
+        return;
+    }
+    mDragging = true;
+    mDragPosition = event->pos();
+    event->accept();
+}
+
+void TimeChartView::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!mDragging || chart()->plotArea().width() <= 0) {
+        QChartView::mouseMoveEvent(event);
+        return;
+    }
+    const double shift = (event->pos().x() - mDragPosition.x())*(mTo - mFrom)/chart()->plotArea().width();
+    mDragPosition = event->pos();
+    setRange(mFrom - shift, mTo - shift);
+    event->accept();
+}
+
+void TimeChartView::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (!mDragging) {
+        QChartView::mouseReleaseEvent(event);
+        return;
+    }
+    mDragging = false;
+    event->accept();
+}
+
+void TimeChartView::scheduleResample()
+{
+    // A burst of wheel or mouse events gives a single resampling
+    if (mResamplePending)
+        return;
+    mResamplePending = true;
+    QTimer::singleShot(0, this, &TimeChartView::resample);
+}
+
+void TimeChartView::setRange(double from, double to)
+{
+    // Not below a day
+    mFrom = from;
+    mTo = std::max(to, from + 86400000.0);
+    mAxisX->setRange(QDateTime::fromMSecsSinceEpoch(qint64(mFrom)), QDateTime::fromMSecsSinceEpoch(qint64(mTo)));
+    scheduleResample();
+}
+
+void TimeChartView::resample()
+{
+    TRACE_SCOPE("chart.resample");
+    mResamplePending = false;
+    const size_t width = std::max(int(chart()->plotArea().width()), 100);
+
+    double left_min = 0;
+    double left_max = 0;
+    double right_min = 0;
+    double right_max = 0;
+    for (Series &series: mSeries) {
+        const std::vector<QPointF> &points = series.points;
+        // The visible points and one more on each side, so that the lines
+        // reach the borders of the plot
+        auto begin = std::lower_bound(points.begin(), points.end(), mFrom, pointBefore);
+        auto end = std::upper_bound(points.begin(), points.end(), mTo, pointAfter);
+        if (begin != points.begin())
+            --begin;
+        if (end != points.end())
+            ++end;
+        const QVector<QPointF> visible = (begin < end) ? downsampleLttb(&*begin, end - begin, width) : QVector<QPointF>();
+
+        double &low = (series.axis == mAxisLeft) ? left_min : right_min;
+        double &high = (series.axis == mAxisLeft) ? left_max : right_max;
+        for (const QPointF &point: visible) {
+            low = std::min(low, point.y());
+            high = std::max(high, point.y());
+        }
+        // One update of the series instead of a signal per point
+        series.line->replace(visible);
+    }
+    mAxisLeft->setRange(left_min, left_max > left_min ? left_max*1.05 : left_min + 1);
+    if (mAxisRight)
+        mAxisRight->setRange(right_min, right_max > right_min ? right_max*1.05 : right_min + 1);
+}
@@ -0,0 +1,72 @@
+#ifndef TIMECHARTVIEW_H
+#define TIMECHARTVIEW_H
+
+#include <vector>
+
+#include <QtCharts/QChartView>
+#include <QtCore/QPointF>
+
+QT_CHARTS_BEGIN_NAMESPACE
+class QDateTimeAxis;
+class QLineSeries;
+class QValueAxis;
+QT_CHARTS_END_NAMESPACE
+
+QT_CHARTS_USE_NAMESPACE
+
+// Line chart over the whole training history on a date axis.
+//
+// The view keeps every point of its series but only hands the visible ones to
+// Qt Charts, reduced to about one point per pixel with LTTB. Panning (drag)
+// and zooming (wheel) move the date axis, the series are then resampled once
+// per event loop turn and updated in place with replace().
+class TimeChartView: public QChartView
+{
+    Q_OBJECT
+public:
+    explicit TimeChartView(const QString &title, QWidget *parent = nullptr);
+
+    // Add a line series, on the right value axis when `right` is set
+    int addSeries(const QString &name, bool right = false);
+    // All the points of a series, x in ms since epoch, ascending
+    void setPoints(int series, std::vector<QPointF> points);
+    // Replace the points of a series with x in [from, to] by `points`, which
+    // lie in that range, ascending
+    void replacePoints(int series, double from, double to, const std::vector<QPointF> &points);
+    // Fit the date axis to the whole history
+    void showAll();
+
+protected:
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
+private Q_SLOTS:
+    void resample();
+
+private:
+    class Series {
+    public:
+        QLineSeries *line;
+        QValueAxis *axis;
+        std::vector<QPointF> points;
+    };
+
+    void scheduleResample();
+    void setRange(double from, double to);
+
+    QDateTimeAxis *mAxisX;
+    QValueAxis *mAxisLeft;
+    QValueAxis *mAxisRight;
+    std::vector<Series> mSeries;
+    double mFrom;
+    double mTo;
+    bool mFitted;
+    bool mResamplePending;
+    bool mDragging;
+    QPoint mDragPosition;
+};
+
+#endif /* TIMECHARTVIEW_H */
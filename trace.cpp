@@ -0,0 +1,173 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMutex>
+#include <QtCore/QSaveFile>
+
+#include "log.h"
+
+std::atomic<bool> gTracingEnabled(false);
+
+namespace {
+
+// Events kept per thread, 512 KiB
+const quint64 kCapacity = 1 << 14;
+
+// Written by its thread only. `head` counts the events ever written, the
+// event i sits in slot i % kCapacity until the event i + kCapacity.
+class TraceBuffer {
+public:
+    quint32 thread = 0;
+    std::atomic<quint64> head{0};
+    TraceEvent events[kCapacity];
+};
+
+// Buffers live as long as the process: the events of a finished thread stay
+// available to the export until a new thread takes its buffer over, so there
+// are never more buffers than threads tracing at once
+QMutex gBuffersMutex;
+std::vector<TraceBuffer *> gBuffers;
+std::vector<TraceBuffer *> gFreeBuffers;
+
+// Gives the buffer of its thread back when the thread exits
+class BufferOwner {
+public:
+    TraceBuffer *buffer = nullptr;
+
+    ~BufferOwner() {
+        if (!buffer)
+            return;
+        QMutexLocker lock(&gBuffersMutex);
+        gFreeBuffers.push_back(buffer);
+    }
+};
+
+TraceBuffer *threadBuffer() {
+    thread_local BufferOwner owner;
+    if (!owner.buffer) {
+        QMutexLocker lock(&gBuffersMutex);
+        if (!gFreeBuffers.empty()) {
+            owner.buffer = gFreeBuffers.back();
+            gFreeBuffers.pop_back();
+        } else {
+            owner.buffer = new TraceBuffer;
+            owner.buffer->thread = quint32(gBuffers.size());
+            gBuffers.push_back(owner.buffer);
+        }
+    }
+    return owner.buffer;
+}
+
+qint64 percentile(std::vector<qint64> &durations, double ratio) {
+    const size_t rank = std::min(size_t(ratio*durations.size()), durations.size() - 1);
+    std::nth_element(durations.begin(), durations.begin() + rank, durations.end());
+    return durations[rank];
+}
+
+} // namespace
+
+void setTracingEnabled(bool enabled)
+{
+    gTracingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 traceClock()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void recordTraceEvent(const char *name, qint64 start, qint64 duration)
+{
+    TraceBuffer *buffer = threadBuffer();
+    const quint64 head = buffer->head.load(std::memory_order_relaxed);
+    buffer->events[head % kCapacity] = TraceEvent{name, start, duration, buffer->thread};
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+std::vector<TraceEvent> traceEvents()
+{
+    std::vector<TraceBuffer *> buffers;
+    {
+        QMutexLocker lock(&gBuffersMutex);
+        buffers = gBuffers;
+    }
+    std::vector<TraceEvent> events;
+    for (TraceBuffer *buffer: buffers) {
+        const quint64 head = buffer->head.load(std::memory_order_acquire);
+        const quint64 first = head > kCapacity ? head - kCapacity : 0;
+        std::vector<TraceEvent> copy;
+        copy.reserve(head - first);
+        for (quint64 i = first; i < head; i++)
+            copy.push_back(buffer->events[i % kCapacity]);
+        // The thread kept tracing during the copy: drop the slots it may
+        // have overwritten, the one being written included
+        const quint64 after = buffer->head.load(std::memory_order_acquire);
+        const quint64 valid = after + 1 > kCapacity ? after + 1 - kCapacity : 0;
+        const size_t skip = size_t(std::min(valid > first ? valid - first : 0, quint64(copy.size())));
+        events.insert(events.end(), copy.begin() + skip, copy.end());
+    }
+    std::sort(events.begin(), events.end(), [](const TraceEvent &a, const TraceEvent &b) {
+        return a.start < b.start;
+    });
+    return events;
+}
+
+int writeChromeTrace(const QString &filename)
+{
+    const std::vector<TraceEvent> events = traceEvents();
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    // Complete events ("X"), times in us
+    QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (size_t i = 0; i < events.size(); i++) {
+        const TraceEvent &event = events[i];
+        json += "{\"name\":\"";
+        json += event.name;
+        json += "\",\"cat\":\"opencyclingtraining\",\"ph\":\"X\",\"ts\":";
+        json += QByteArray::number(event.start/1e3, 'f', 3);
+        json += ",\"dur\":";
+        json += QByteArray::number(event.duration/1e3, 'f', 3);
+        json += ",\"pid\":";
+        json += pid;
+        json += ",\"tid\":";
+        json += QByteArray::number(event.thread);
+        json += (i + 1 < events.size()) ? "},\n" : "}\n";
+    }
+    json += "]}\n";
+
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+        LOG_ERROR("Cannot write the trace to "<<filename.toStdString());
+        return 1;
+    }
+    LOG_INFO("Trace saved to "<<filename.toStdString()<<" ("<<events.size()<<" events)");
+    return 0;
+}
+
+std::vector<TraceStats> traceStats(size_t window)
+{
+    const std::vector<TraceEvent> events = traceEvents();
+    // Latest events first, so that each stage keeps its last `window`
+    std::map<std::string, std::vector<qint64>> durations;
+    for (auto event = events.rbegin(); event != events.rend(); ++event) {
+        std::vector<qint64> &stage = durations[event->name];
+        if (stage.size() < window)
+            stage.push_back(event->duration);
+    }
+    std::vector<TraceStats> stats;
+    for (auto &stage: durations) {
+        TraceStats stat;
+        stat.name = QString::fromStdString(stage.first);
+        stat.count = stage.second.size();
+        stat.max = *std::max_element(stage.second.begin(), stage.second.end());
+        stat.p50 = percentile(stage.second, 0.50);
+        stat.p99 = percentile(stage.second, 0.99);
+        stats.push_back(stat);
+    }
+    return stats;
+}
@@ -0,0 +1,76 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <vector>
+
+#include <QtCore/QString>
+#include <QtCore/QtGlobal>
+
+// Scoped timers on the hot paths.
+//
+// TRACE_SCOPE("stage") records the time spent in the enclosing block into a
+// ring buffer owned by the calling thread: no lock, no allocation after the
+// first event of a thread. Tracing is off by default and then costs one
+// relaxed atomic load per scope; building with OPENCYCLINGTRAINING_NO_TRACE
+// removes the scopes altogether.
+
+class TraceEvent {
+public:
+    const char *name;   // a string literal
+    qint64 start;       // ns on the monotonic clock
+    qint64 duration;    // ns
+    quint32 thread;     // order in which the threads first traced
+};
+
+// Durations of one stage over the last events
+class TraceStats {
+public:
+    QString name;
+    size_t count;
+    qint64 p50;     // ns
+    qint64 p99;
+    qint64 max;
+};
+
+extern std::atomic<bool> gTracingEnabled;
+
+inline bool tracingEnabled() { return gTracingEnabled.load(std::memory_order_relaxed); }
+void setTracingEnabled(bool enabled);
+
+qint64 traceClock();
+void recordTraceEvent(const char *name, qint64 start, qint64 duration);
+
+class TraceScope {
+public:
+    explicit TraceScope(const char *name):
+        mName(tracingEnabled() ? name : nullptr),
+        mStart(mName ? traceClock() : 0) {}
+    ~TraceScope() {
+        if (mName)
+            recordTraceEvent(mName, mStart, traceClock() - mStart);
+    }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *mName;
+    qint64 mStart;
+};
+
+// The events still in the buffers of all the threads, oldest first
+std::vector<TraceEvent> traceEvents();
+// Chrome trace_event JSON, for chrome://tracing or ui.perfetto.dev
+int writeChromeTrace(const QString &filename);
+// p50/p99 of each stage over its last `window` events, by name
+std::vector<TraceStats> traceStats(size_t window = 256);
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#if defined(OPENCYCLINGTRAINING_NO_TRACE)
+#define TRACE_SCOPE(name) do {} while (false)
+#else
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#endif
+
+#endif /* TRACE_H */
@@ -0,0 +1,14 @@
+#include "trainingbackend.h"
+
+#include <QtCore/QFileInfo>
+
+#include "sqlitebackend.h"
+#include "trainingjournal.h"
+
+std::unique_ptr<TrainingBackend> openTrainingBackend(const std::string &filename)
+{
+    const QString suffix = QFileInfo(QString::fromStdString(filename)).suffix().toLower();
+    if (suffix == "db" || suffix == "sqlite")
+        return std::unique_ptr<TrainingBackend>(new SqliteBackend(filename));
+    return std::unique_ptr<TrainingBackend>(new TrainingJournal(filename));
+}
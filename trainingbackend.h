@@ -0,0 +1,50 @@
+#ifndef TRAININGBACKEND_H
+#define TRAININGBACKEND_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "trainingfile.h"
+
+// Content hash of the trainings of a year
+class TrainingYearHash {
+public:
+    qint32 year;
+    quint64 hash;
+};
+
+// Where the trainings are kept. The GUI and the batch tool only go through
+// this interface; there is the CSV snapshot with its journal
+// (TrainingJournal) and an SQLite database (SqliteBackend).
+class TrainingBackend {
+public:
+    virtual ~TrainingBackend() {}
+
+    // Every training, ordered by date with one item per day
+    virtual TrainingRecords load(std::vector<TrainingFileError> *errors = nullptr) = 0;
+    // Trainings from `from` to `to` included, ordered by date, only the ones
+    // of `category` when it is not empty
+    virtual TrainingRecords query(const QDate &from, const QDate &to, const QString &category = QString()) = 0;
+    // Add or replace the training of item.date, 0 on success
+    virtual int save(const TrainingItem &item) = 0;
+
+    // Housekeeping that reads the whole content back (rewriting a snapshot),
+    // when the backend asks for it
+    virtual bool needsCompaction() const { return false; }
+    virtual void compact() {}
+    virtual void waitForCompaction() {}
+
+    // One hash per year holding trainings, in year order, that changes with
+    // the content of the year; empty when the backend cannot tell without
+    // reading everything (the derived series are not cached then)
+    virtual std::vector<TrainingYearHash> yearHashes() { return std::vector<TrainingYearHash>(); }
+
+    virtual const std::string &filename() const = 0;
+};
+
+// An SQLite database for the ".db" and ".sqlite" files, the CSV and its
+// journal otherwise
+std::unique_ptr<TrainingBackend> openTrainingBackend(const std::string &filename);
+
+#endif /* TRAININGBACKEND_H */
@@ -0,0 +1,609 @@
+#include "trainingfile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string_view>
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QByteArray>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+#include <QtCore/QThread>
+
+#include "log.h"
+#include "trace.h"
+
+namespace {
+
+const int kFieldCount = 16;
+
+const char *const kFieldNames[kFieldCount] = {
+    "weather", "date", "training", "hour", "feeling", "daily_objective",
+    "TSS", "Km_per_day", "hour_objective", "TSS_objective", "category",
+    "muscu", "muscu_objective", "km_per_week_objective",
+    "hour_per_week_objective", "TSS_per_week_objective"
+};
+
+const char *const kMonthNames[12] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+std::string_view trimmed(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+        text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r'))
+        text.remove_suffix(1);
+    return text;
+}
+
+bool parseDouble(std::string_view text, double &value) {
+    text = trimmed(text);
+    if (text.empty())
+        return false;
+#if defined(__cpp_lib_to_chars)
+    const char *first = text.data();
+    const char *last = text.data() + text.size();
+    if (*first == '+')
+        first++;
+    std::from_chars_result result = std::from_chars(first, last, value);
+    return result.ec == std::errc() && result.ptr == last;
+#else
+    // Older standard libraries (MinGW 7) have no floating point from_chars,
+    // QByteArray::toDouble() is locale independent and works on raw data too.
+    bool ok = false;
+    value = QByteArray::fromRawData(text.data(), int(text.size())).toDouble(&ok);
+    return ok;
+#endif
+}
+
+int parseNumber(std::string_view text, bool &ok) {
+    int value = 0;
+    ok = !text.empty() && text.size() <= 4;
+    for (char c: text) {
+        if (c < '0' || c > '9') {
+            ok = false;
+            break;
+        }
+        value = value*10 + (c - '0');
+    }
+    return value;
+}
+
+// Fast path for the "Sat Jun 6 2020" format written by QDate::toString()
+bool parseTextDate(std::string_view text, QDate &date) {
+    if (text.size() < 12 || text[3] != ' ' || text[7] != ' ')
+        return false;
+    int month = 0;
+    for (int i = 0; i < 12; i++) {
+        if (text.compare(4, 3, kMonthNames[i]) == 0) {
+            month = i+1;
+            break;
+        }
+    }
+    if (month == 0)
+        return false;
+    text.remove_prefix(8);
+    size_t space = text.find(' ');
+    if (space == std::string_view::npos)
+        return false;
+    bool ok_day, ok_year;
+    int day = parseNumber(text.substr(0, space), ok_day);
+    int year = parseNumber(text.substr(space+1), ok_year);
+    if (!ok_day || !ok_year)
+        return false;
+    date.setDate(year, month, day);
+    return date.isValid();
+}
+
+QDate parseDate(std::string_view text) {
+    text = trimmed(text);
+    QDate date;
+    if (parseTextDate(text, date))
+        return date;
+    // Localized day/month names
+    return QDate::fromString(QString::fromUtf8(text.data(), int(text.size())));
+}
+
+class RecordParser {
+public:
+    RecordParser(TrainingRecords &database, std::vector<TrainingFileError> *errors):
+        mDatabase(database),
+        mErrors(errors)
+    {
+    }
+
+    void parse(const char *begin, const char *end, size_t first_line) {
+        const char *p = begin;
+        size_t line = first_line;
+        size_t record_line = line;
+        int count_items = 0;
+
+        while (p < end) {
+            // Scan one field, a quote toggles the "in_apo" state and the
+            // separators inside quotes are part of the field.
+            const char *start = p;
+            bool in_apo = false;
+            int quotes = 0;
+            for (; p < end; p++) {
+                const char c = *p;
+                if (c == '"') {
+                    in_apo = !in_apo;
+                    quotes++;
+                } else if (c == '\n') {
+                    if (!in_apo)
+                        break;
+                    line++;
+                } else if (c == ',' && !in_apo) {
+                    break;
+                }
+            }
+
+            std::string_view field = fieldValue(start, p, quotes, count_items);
+            const bool end_of_record = (p == end || *p == '\n');
+            if (!end_of_record || !trimmed(field).empty()) {
+                if (count_items < kFieldCount)
+                    mFields[count_items] = field;
+                count_items++;
+            }
+            if (end_of_record) {
+                if (count_items > 0)
+                    addRecord(count_items, record_line);
+                count_items = 0;
+                line++;
+                record_line = line;
+            }
+            if (p < end)
+                p++; // skip the separator
+        }
+        // Last line without line feed
+        if (count_items > 0)
+            addRecord(count_items, record_line);
+    }
+
+private:
+    std::string_view fieldValue(const char *start, const char *stop, int quotes, int index) {
+        if (quotes == 0)
+            return std::string_view(start, stop - start);
+        if (quotes == 2 && *start == '"' && *(stop-1) == '"')
+            return std::string_view(start + 1, stop - start - 2);
+        if (index >= kFieldCount)
+            return std::string_view();
+        // Rare case: quotes in the middle of the field, drop them
+        std::string &scratch = mScratch[index];
+        scratch.clear();
+        for (const char *c = start; c < stop; c++) {
+            if (*c != '"')
+                scratch.push_back(*c);
+        }
+        return scratch;
+    }
+
+    void report(size_t line, const std::string &message) {
+        LOG_ERROR("Line "<<line<<": "<<message);
+        if (mErrors)
+            mErrors->push_back(TrainingFileError{line, message});
+    }
+
+    float number(int index, size_t line) {
+        double value = 0;
+        if (!parseDouble(mFields[index], value)) {
+            report(line, std::string(kFieldNames[index]) + ": \"" + std::string(mFields[index]) + "\" is not a double");
+            value = 0;
+        }
+        return float(value);
+    }
+
+    void addRecord(int count_items, size_t line) {
+        if (count_items < kFieldCount) {
+            report(line, "Too few items (" + std::to_string(count_items) + " instead of " + std::to_string(kFieldCount) + ")");
+            return;
+        }
+        if (count_items > kFieldCount)
+            report(line, "Too many items (" + std::to_string(count_items) + " instead of " + std::to_string(kFieldCount) + ")");
+
+        QDate date = parseDate(mFields[1]);
+        if (!date.isValid()) {
+            report(line, "\"" + std::string(mFields[1]) + "\" is not a date");
+            return;
+        }
+
+        // Rows of the file share one copy of each text
+        StringPool &strings = mDatabase.strings;
+        TrainingRecord current_item;
+        current_item.weather = strings.intern(mFields[0]);
+        current_item.day = qint32(date.toJulianDay());
+        current_item.training = strings.intern(mFields[2]);
+        current_item.hour = number(3, line);
+        current_item.feeling = quint8(std::min(std::max(number(4, line), 0.0f), 255.0f));
+        current_item.daily_objective = strings.intern(mFields[5]);
+        current_item.TSS = number(6, line);
+        current_item.Km_per_day = number(7, line);
+        current_item.hour_objective = number(8, line);
+        current_item.TSS_objective = number(9, line);
+        current_item.category = strings.intern(mFields[10]);
+        current_item.muscu = strings.intern(mFields[11]);
+        current_item.muscu_objective = strings.intern(mFields[12]);
+        current_item.km_per_week_objective = number(13, line);
+        current_item.hour_per_week_objective = number(14, line);
+        current_item.TSS_per_week_objective = number(15, line);
+        mDatabase.rows.push_back(current_item);
+    }
+
+    TrainingRecords &mDatabase;
+    std::vector<TrainingFileError> *mErrors;
+    std::string_view mFields[kFieldCount];
+    std::string mScratch[kFieldCount];
+};
+
+// Smaller files are parsed on the calling thread
+const qint64 kParallelSize = 8 << 20;
+const qint64 kChunkSize = 2 << 20;
+
+// Fixed-size slice of the file. Whether it starts inside quotes is only
+// known once the slices before it are scanned, so the scan notes where the
+// first record would start in both cases.
+class Chunk {
+public:
+    const char *begin;
+    const char *end;
+    int quotes;                  // parity of the quotes in [begin, end)
+    size_t lines;                // line feeds in [begin, end)
+    const char *record[2];       // first record when `begin` is outside (0) or inside (1) quotes, null if none
+    size_t record_lines[2];      // line feeds in [begin, record[i])
+};
+
+// Records from `begin` to `end`, parsed on their own
+class Slice {
+public:
+    const char *begin;
+    const char *end;
+    size_t first_line;
+    TrainingRecords records;
+    std::vector<TrainingFileError> errors;
+};
+
+void scanChunk(Chunk &chunk) {
+    int parity = 0;
+    size_t lines = 0;
+    chunk.record[0] = chunk.record[1] = nullptr;
+    for (const char *p = chunk.begin; p < chunk.end; p++) {
+        if (*p == '"') {
+            parity ^= 1;
+        } else if (*p == '\n') {
+            lines++;
+            // Outside quotes if the chunk started in the state `parity`
+            if (!chunk.record[parity]) {
+                chunk.record[parity] = p + 1;
+                chunk.record_lines[parity] = lines;
+            }
+        }
+    }
+    chunk.quotes = parity;
+    chunk.lines = lines;
+}
+
+// The file cut at record boundaries in about one slice per chunk: chunks are
+// scanned in parallel, then their real quote state at start follows from
+// the parities of the ones before.
+std::vector<Slice> sliceRecords(const char *data, const char *end, size_t first_line) {
+    const qint64 size = end - data;
+    const qint64 count = std::min<qint64>(std::max<qint64>(size/kChunkSize, 1), 4*QThread::idealThreadCount());
+    std::vector<Chunk> chunks(count);
+    for (qint64 i = 0; i < count; i++) {
+        chunks[i].begin = data + size*i/count;
+        chunks[i].end = data + size*(i + 1)/count;
+    }
+    QtConcurrent::blockingMap(chunks, scanChunk);
+
+    std::vector<Slice> slices(1);
+    slices.back().begin = data;
+    slices.back().first_line = first_line;
+    int quotes = 0;
+    size_t lines = 0;
+    for (const Chunk &chunk: chunks) {
+        // A chunk without a record start (one long quoted field) stays in the
+        // slice before it
+        if (&chunk != &chunks.front() && chunk.record[quotes]) {
+            slices.back().end = chunk.record[quotes];
+            slices.emplace_back();
+            slices.back().begin = chunk.record[quotes];
+            slices.back().first_line = first_line + lines + chunk.record_lines[quotes];
+        }
+        quotes ^= chunk.quotes;
+        lines += chunk.lines;
+    }
+    slices.back().end = end;
+    return slices;
+}
+
+void parseRecords(const char *data, const char *end, size_t first_line, TrainingRecords &database, std::vector<TrainingFileError> *errors) {
+    if (end - data < kParallelSize || QThread::idealThreadCount() < 2) {
+        // One record per line
+        database.rows.reserve(database.rows.size() + std::count(data, end, '\n') + 1);
+        RecordParser parser(database, errors);
+        parser.parse(data, end, first_line);
+    } else {
+        // Slices parsed on all the cores, appended in file order
+        std::vector<Slice> slices = sliceRecords(data, end, first_line);
+        QtConcurrent::blockingMap(slices, [errors](Slice &slice) {
+            RecordParser parser(slice.records, errors ? &slice.errors : nullptr);
+            parser.parse(slice.begin, slice.end, slice.first_line);
+        });
+        size_t rows = database.rows.size();
+        for (const Slice &slice: slices)
+            rows += slice.records.rows.size();
+        database.rows.reserve(rows);
+        for (const Slice &slice: slices) {
+            database.append(slice.records);
+            if (errors)
+                errors->insert(errors->end(), slice.errors.begin(), slice.errors.end());
+        }
+    }
+}
+
+// Sidecar index: magic, version, year count, snapshot size and modification
+// time (ms since epoch), then year, offset, size and first line of each year
+const char kIndexMagic[4] = {'O', 'C', 'T', 'I'};
+const int kIndexVersion = 1;
+const int kIndexHeaderSize = 4 + 2 + 2 + 8 + 8;
+const int kIndexYearSize = 4 + 8 + 8 + 8;
+
+void appendValue(QByteArray &data, quint64 value, int size) {
+    for (int i = 0; i < size; i++)
+        data.append(char((value >> (8*i)) & 0xff));
+}
+
+quint64 readValue(const char *p, int size) {
+    quint64 value = 0;
+    for (int i = 0; i < size; i++)
+        value |= quint64(uchar(p[i])) << (8*i);
+    return value;
+}
+
+QString indexName(const std::string &filename) {
+    return QString::fromStdString(filename + ".index");
+}
+
+// The years of a snapshot sorted by date, from the date of each record.
+// Empty when a year comes back after a later one.
+std::vector<TrainingFileYear> scanYears(const char *data, const char *end) {
+    std::vector<TrainingFileYear> years;
+    const char *p = data;
+    size_t line = 1;
+    while (p < end) {
+        const char *record = p;
+        const size_t record_line = line;
+        // The date is the second field, separators inside quotes do not count
+        const char *field = p;
+        std::string_view date;
+        int index = 0;
+        bool in_apo = false;
+        for (; p < end; p++) {
+            if (*p == '"') {
+                in_apo = !in_apo;
+            } else if (*p == '\n') {
+                line++;
+                if (!in_apo)
+                    break;
+            } else if (*p == ',' && !in_apo) {
+                if (index++ == 1)
+                    date = std::string_view(field, p - field);
+                field = p + 1;
+            }
+        }
+        if (p < end)
+            p++;
+        date = trimmed(date);
+        if (date.size() >= 2 && date.front() == '"' && date.back() == '"')
+            date = date.substr(1, date.size() - 2);
+        const QDate day = parseDate(date);
+        if (!day.isValid())
+            continue;
+        if (!years.empty() && day.year() < years.back().year)
+            return std::vector<TrainingFileYear>();
+        if (years.empty() || day.year() != years.back().year)
+            years.push_back(TrainingFileYear{day.year(), TrainingFileRange{record - data, 0, record_line}});
+    }
+    for (size_t i = 0; i < years.size(); i++) {
+        const qint64 next = i + 1 < years.size() ? years[i + 1].range.offset : end - data;
+        years[i].range.size = next - years[i].range.offset;
+    }
+    return years;
+}
+
+void writeIndex(const std::string &filename, const std::vector<TrainingFileYear> &years) {
+    const QFileInfo info(QString::fromStdString(filename));
+    QByteArray data;
+    data.reserve(kIndexHeaderSize + kIndexYearSize*int(years.size()));
+    data.append(kIndexMagic, 4);
+    appendValue(data, kIndexVersion, 2);
+    appendValue(data, years.size(), 2);
+    appendValue(data, quint64(info.size()), 8);
+    appendValue(data, quint64(info.lastModified().toMSecsSinceEpoch()), 8);
+    for (const TrainingFileYear &year: years) {
+        appendValue(data, quint32(year.year), 4);
+        appendValue(data, quint64(year.range.offset), 8);
+        appendValue(data, quint64(year.range.size), 8);
+        appendValue(data, year.range.first_line, 8);
+    }
+    // Only an optimization: a failure just means a scan at next start
+    QSaveFile file(indexName(filename));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+        LOG_WARNING("Cannot write the index of "<<filename);
+}
+
+// The index when it still describes the snapshot
+bool readIndex(const std::string &filename, std::vector<TrainingFileYear> &years) {
+    const QFileInfo info(QString::fromStdString(filename));
+    QFile file(indexName(filename));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    const QByteArray data = file.readAll();
+    if (data.size() < kIndexHeaderSize || data.left(4) != QByteArray(kIndexMagic, 4))
+        return false;
+    const char *p = data.constData();
+    const size_t count = readValue(p + 6, 2);
+    if (readValue(p + 4, 2) != kIndexVersion
+            || qint64(readValue(p + 8, 8)) != info.size()
+            || qint64(readValue(p + 16, 8)) != info.lastModified().toMSecsSinceEpoch()
+            || data.size() != kIndexHeaderSize + kIndexYearSize*qint64(count))
+        return false;
+    years.clear();
+    for (p += kIndexHeaderSize; years.size() < count; p += kIndexYearSize) {
+        const TrainingFileRange range{qint64(readValue(p + 4, 8)), qint64(readValue(p + 12, 8)), size_t(readValue(p + 20, 8))};
+        years.push_back(TrainingFileYear{qint32(readValue(p, 4)), range});
+    }
+    return true;
+}
+
+} // namespace
+
+void loadTrainingsFromFile(const std::string &filename, TrainingRecords &database, std::vector<TrainingFileError> *errors) {
+    loadTrainingsFromFile(filename, TrainingFileRange{0, -1, 1}, database, errors);
+}
+
+void loadTrainingsFromFile(const std::string &filename, const TrainingFileRange &range, TrainingRecords &database, std::vector<TrainingFileError> *errors) {
+    TRACE_SCOPE("file.load");
+    QFile myfile(QString::fromStdString(filename));
+
+    if (!myfile.open(QIODevice::ReadOnly)) {
+        LOG_ERROR("Cannot load training data from "<<filename);
+        return;
+    }
+    const qint64 offset = std::min(range.offset, myfile.size());
+    const qint64 size = range.size < 0 ? myfile.size() - offset : std::min(range.size, myfile.size() - offset);
+    if (size == 0)
+        return;
+
+    const char *data = reinterpret_cast<const char *>(myfile.map(offset, size));
+    if (!data) {
+        LOG_ERROR("Cannot map "<<filename<<" into memory");
+        return;
+    }
+    parseRecords(data, data + size, range.first_line, database, errors);
+    myfile.unmap(reinterpret_cast<uchar *>(const_cast<char *>(data)));
+}
+
+std::vector<TrainingFileYear> trainingFileIndex(const std::string &filename) {
+    std::vector<TrainingFileYear> years;
+    if (readIndex(filename, years))
+        return years;
+
+    TRACE_SCOPE("file.index");
+    QFile myfile(QString::fromStdString(filename));
+    if (!myfile.open(QIODevice::ReadOnly))
+        return years;
+    const qint64 size = myfile.size();
+    const char *data = size > 0 ? reinterpret_cast<const char *>(myfile.map(0, size)) : nullptr;
+    if (data) {
+        years = scanYears(data, data + size);
+        myfile.unmap(reinterpret_cast<uchar *>(const_cast<char *>(data)));
+    }
+    writeIndex(filename, years);
+    return years;
+}
+
+quint64 contentHash(const char *data, size_t size, quint64 seed) {
+    // 8 bytes a step through the finalizer of splitmix64
+    auto mix = [](quint64 value) {
+        value = (value ^ (value >> 30))*0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27))*0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    };
+    quint64 hash = mix(seed ^ (size*0x9e3779b97f4a7c15ull));
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        quint64 word;
+        std::memcpy(&word, data + i, 8);
+        hash = mix(hash ^ word);
+    }
+    quint64 tail = 0;
+    for (; i < size; i++)
+        tail = (tail << 8) | uchar(data[i]);
+    return mix(hash ^ tail);
+}
+
+quint64 trainingFileHash(const std::string &filename, const TrainingFileRange &range) {
+    QFile myfile(QString::fromStdString(filename));
+    if (!myfile.open(QIODevice::ReadOnly))
+        return 0;
+    const qint64 offset = std::min(range.offset, myfile.size());
+    const qint64 size = range.size < 0 ? myfile.size() - offset : std::min(range.size, myfile.size() - offset);
+    if (size == 0)
+        return contentHash(nullptr, 0);
+    const char *data = reinterpret_cast<const char *>(myfile.map(offset, size));
+    if (!data)
+        return 0;
+    const quint64 hash = contentHash(data, size_t(size));
+    myfile.unmap(reinterpret_cast<uchar *>(const_cast<char *>(data)));
+    return hash;
+}
+
+void writeTrainingLine(std::ostream &myfile, const TrainingItem &item) {
+    myfile << "\"" << item.weather.toUtf8().constData() << "\",";
+    myfile << "\"" << item.date.toString().toUtf8().constData() << "\",";
+    myfile << "\"" << item.training.toUtf8().constData() << "\",";
+    myfile << "\"" << item.hour << "\",";
+    myfile << "\"" << item.feeling << "\",";
+    myfile << "\"" << item.daily_objective.toUtf8().constData() << "\",";
+    myfile << "\"" << item.TSS << "\",";
+    myfile << "\"" << item.Km_per_day << "\",";
+    myfile << "\"" << item.hour_objective << "\",";
+    myfile << "\"" << item.TSS_objective << "\",";
+    myfile << "\"" << item.category.toUtf8().constData() << "\",";
+    myfile << "\"" << item.muscu.toUtf8().constData() << "\",";
+    myfile << "\"" << item.muscu_objective.toUtf8().constData() << "\",";
+    myfile << "\"" << item.km_per_week_objective << "\",";
+    myfile << "\"" << item.hour_per_week_objective << "\",";
+    myfile << "\"" << item.TSS_per_week_objective << "\",\n";
+}
+
+int saveTrainingsToFile(const std::string &filename, const std::vector<TrainingItem> &trainings) {
+    TRACE_SCOPE("file.save");
+    // QSaveFile writes to a temporary file and renames it over the old one
+    // on commit(), a crash in the middle of a save never leaves a truncated
+    // training file behind.
+    QSaveFile myfile(QString::fromStdString(filename));
+    if (!myfile.open(QIODevice::WriteOnly)) {
+        LOG_ERROR("Cannot save training to "<<filename);
+        return 1;
+    }
+    std::ostringstream buffer;
+    // Where each year starts, while the trainings come in date order
+    std::vector<TrainingFileYear> years;
+    bool sorted = true;
+    for (const TrainingItem &item: trainings) {
+        const int year = item.date.year();
+        if (item.date.isValid() && (years.empty() || year != years.back().year)) {
+            sorted = sorted && (years.empty() || year > years.back().year);
+            years.push_back(TrainingFileYear{year, TrainingFileRange{qint64(buffer.tellp()), 0, 0}});
+        }
+        writeTrainingLine(buffer, item);
+    }
+    const std::string data = buffer.str();
+    if (myfile.write(data.data(), data.size()) != qint64(data.size()) || !myfile.commit()) {
+        LOG_ERROR("Cannot save training to "<<filename);
+        return 1;
+    }
+    if (!sorted)
+        years.clear();
+    size_t lines = 0;
+    qint64 counted = 0;
+    for (size_t i = 0; i < years.size(); i++) {
+        TrainingFileRange &range = years[i].range;
+        lines += std::count(data.begin() + counted, data.begin() + range.offset, '\n');
+        counted = range.offset;
+        range.first_line = 1 + lines;
+        range.size = (i + 1 < years.size() ? years[i + 1].range.offset : qint64(data.size())) - range.offset;
+    }
+    writeIndex(filename, years);
+    LOG_INFO("Training datas saved to file "<<filename<<" ("<<trainings.size()<<" lines)");
+    return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef TRAININGFILE_H
+#define TRAININGFILE_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "trainingitem.h"
+
+class TrainingFileError {
+public:
+    size_t line; // 1-based line where the faulty record starts
+    std::string message;
+};
+
+// Bytes of a training file holding whole records, `size` -1 up to the end
+class TrainingFileRange {
+public:
+    qint64 offset;
+    qint64 size;
+    size_t first_line; // line number of the first record, for the errors
+};
+
+// The records of one year in a snapshot sorted by date
+class TrainingFileYear {
+public:
+    qint32 year;
+    TrainingFileRange range;
+};
+
+// Parse a training CSV file and append its rows to `database`, in file order.
+// The file is memory-mapped and fields are decoded in place; only text fields
+// are copied, once per distinct value, into database.strings. Rows that
+// cannot be used (bad date, missing fields) are skipped, other problems are
+// reported and the faulty value is set to 0. Large files are parsed in
+// slices on the global thread pool, with the same rows and errors.
+void loadTrainingsFromFile(const std::string &filename, TrainingRecords &database, std::vector<TrainingFileError> *errors = nullptr);
+// Only the records of `range`
+void loadTrainingsFromFile(const std::string &filename, const TrainingFileRange &range, TrainingRecords &database, std::vector<TrainingFileError> *errors = nullptr);
+
+// Where each year starts in a snapshot sorted by date, from the sidecar
+// "<filename>.index". The sidecar is written with the snapshot and rebuilt
+// from a scan of the dates when the snapshot changed behind it (size or
+// modification time). Empty when the snapshot is not sorted by date.
+std::vector<TrainingFileYear> trainingFileIndex(const std::string &filename);
+
+// 64-bit hash of `size` bytes continuing from `seed`, to notice changes (not
+// a cryptographic hash)
+quint64 contentHash(const char *data, size_t size, quint64 seed = 0);
+// Hash of the bytes of `range` in the file, 0 when they cannot be read
+quint64 trainingFileHash(const std::string &filename, const TrainingFileRange &range);
+
+// Write all the trainings, the file is replaced atomically. The year index
+// is written next to it when they are in date order.
+int saveTrainingsToFile(const std::string &filename, const std::vector<TrainingItem> &trainings);
+
+// Write one record, as stored in the training file and in its journal.
+void writeTrainingLine(std::ostream &myfile, const TrainingItem &item);
+
+#endif /* TRAININGFILE_H */
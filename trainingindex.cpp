@@ -0,0 +1,152 @@
+#include "trainingindex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+size_t lowBit(size_t i)
+{
+    return i & (~i + 1);
+}
+
+// The values are typed in with a couple of decimals at most
+const double kScale = 1e6;
+
+qint64 fixedPoint(double value)
+{
+    return std::llround(value*kScale);
+}
+
+// True when the slots of `layout` are those of `old` followed by new ones
+bool appendsTo(const SlotLayout &layout, const SlotLayout &old)
+{
+    if (old.runs.empty() || layout.runs.size() < old.runs.size())
+        return false;
+    const size_t last = old.runs.size() - 1;
+    const SlotLayout::Run &before = old.runs[last];
+    const SlotLayout::Run &after = layout.runs[last];
+    return std::equal(old.runs.begin(), old.runs.begin() + last, layout.runs.begin())
+        && after.first_day == before.first_day && after.slot == before.slot && after.count >= before.count;
+}
+
+} // namespace
+
+TrainingIndex::TrainingIndex():
+    mCount(0)
+{
+}
+
+void TrainingIndex::build(const TrainingStore &trainings)
+{
+    mLayout = trainings.layout();
+    mCount = trainings.slotCount();
+    mValues.assign(mCount*kColumnCount, 0);
+    mTree.assign((mCount + 1)*kColumnCount, 0);
+    for (int column = 0; column < kColumnCount; column++) {
+        const double *values = trainings.column(TrainingStore::Column(column));
+        for (size_t slot = 0; slot < mCount; slot++) {
+            const qint64 value = fixedPoint(values[slot]);
+            mValues[slot*kColumnCount + column] = value;
+            mTree[(slot + 1)*kColumnCount + column] = value;
+        }
+    }
+    // Each node adds itself to its parent once, O(n)
+    for (size_t node = 1; node <= mCount; node++) {
+        const size_t parent = node + lowBit(node);
+        if (parent > mCount)
+            continue;
+        for (int column = 0; column < kColumnCount; column++)
+            mTree[parent*kColumnCount + column] += mTree[node*kColumnCount + column];
+    }
+}
+
+void TrainingIndex::update(const TrainingStore &trainings, const QDate &date)
+{
+    // Days added before other slots shift them
+    if (!appendsTo(trainings.layout(), mLayout)) {
+        build(trainings);
+        return;
+    }
+    // Days added after the last one get their nodes, already up to date
+    if (mCount < trainings.slotCount())
+        mLayout = trainings.layout();
+    while (mCount < trainings.slotCount())
+        append(trainings, mCount);
+
+    const size_t slot = mLayout.slotOf(date.toJulianDay());
+    if (slot == SlotLayout::kNoSlot)
+        return;
+    qint64 delta[kColumnCount];
+    bool changed = false;
+    for (int column = 0; column < kColumnCount; column++) {
+        const qint64 value = fixedPoint(trainings.column(TrainingStore::Column(column))[slot]);
+        delta[column] = value - mValues[slot*kColumnCount + column];
+        mValues[slot*kColumnCount + column] = value;
+        changed = changed || delta[column] != 0;
+    }
+    if (changed)
+        add(slot, delta);
+}
+
+void TrainingIndex::sums(const QDate &from, const QDate &to, double *out) const
+{
+    std::fill(out, out + kColumnCount, 0.0);
+    const size_t begin = mLayout.lowerSlot(from.toJulianDay());
+    const size_t end = mLayout.lowerSlot(to.toJulianDay() + 1);
+    if (begin >= end)
+        return;
+    qint64 after[kColumnCount] = {};
+    qint64 before[kColumnCount] = {};
+    prefix(end, after);
+    prefix(begin, before);
+    for (int column = 0; column < kColumnCount; column++)
+        out[column] = (after[column] - before[column])/kScale;
+}
+
+double TrainingIndex::sum(TrainingStore::Column column, const QDate &from, const QDate &to) const
+{
+    Q_ASSERT(column < kColumnCount);
+    double values[kColumnCount];
+    sums(from, to, values);
+    return values[column];
+}
+
+void TrainingIndex::prefix(size_t count, qint64 *out) const
+{
+    for (size_t node = count; node > 0; node -= lowBit(node)) {
+        const qint64 *values = &mTree[node*kColumnCount];
+        for (int column = 0; column < kColumnCount; column++)
+            out[column] += values[column];
+    }
+}
+
+void TrainingIndex::add(size_t slot, const qint64 *delta)
+{
+    for (size_t node = slot + 1; node <= mCount; node += lowBit(node)) {
+        qint64 *values = &mTree[node*kColumnCount];
+        for (int column = 0; column < kColumnCount; column++)
+            values[column] += delta[column];
+    }
+}
+
+void TrainingIndex::append(const TrainingStore &trainings, size_t slot)
+{
+    // Node slot+1 covers the slots (slot+1-lowBit, slot], the ones before the
+    // new slot are the children already in the tree
+    const size_t node = slot + 1;
+    mValues.resize((slot + 1)*kColumnCount);
+    mTree.resize((node + 1)*kColumnCount);
+    qint64 *values = &mTree[node*kColumnCount];
+    for (int column = 0; column < kColumnCount; column++) {
+        const qint64 value = fixedPoint(trainings.column(TrainingStore::Column(column))[slot]);
+        mValues[slot*kColumnCount + column] = value;
+        values[column] = value;
+    }
+    for (size_t child = node - 1; child > node - lowBit(node); child -= lowBit(child)) {
+        const qint64 *child_values = &mTree[child*kColumnCount];
+        for (int column = 0; column < kColumnCount; column++)
+            values[column] += child_values[column];
+    }
+    mCount = slot + 1;
+}
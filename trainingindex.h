@@ -0,0 +1,46 @@
+#ifndef TRAININGINDEX_H
+#define TRAININGINDEX_H
+
+#include <vector>
+
+#include "trainingstore.h"
+
+// Sums of the daily columns of a TrainingStore over any range of days.
+//
+// A Fenwick tree over the slots of the store holds the TSS, hours, km and
+// their objectives side by side, so the totals of a week, a month, a season or
+// any other range are two prefix sums, O(log n) whatever the length of the
+// range. Editing a day (or adding days after the last one) is O(log n) as
+// well, only a day added before other slots rebuilds the tree. The values are kept in
+// millionths as integers, so sums stay exact however many edits went through.
+class TrainingIndex {
+public:
+    // The indexed columns: TSS, Hour, Km, TSSObjective, HourObjective and
+    // KmObjective, the ones that make sense summed over days
+    static const int kColumnCount = TrainingStore::TSSWeekObjective;
+
+    TrainingIndex();
+
+    // Index the whole store, O(n)
+    void build(const TrainingStore &trainings);
+    // The training of `date` was added or modified in `trainings`
+    void update(const TrainingStore &trainings, const QDate &date);
+
+    // Sum of the indexed columns from `from` to `to` included, in Column order
+    void sums(const QDate &from, const QDate &to, double *out) const;
+    // Sum of one of them
+    double sum(TrainingStore::Column column, const QDate &from, const QDate &to) const;
+
+private:
+    // Sum of slots [0, count), added to `out`
+    void prefix(size_t count, qint64 *out) const;
+    void add(size_t slot, const qint64 *delta);
+    void append(const TrainingStore &trainings, size_t slot);
+
+    SlotLayout mLayout;          // of the store, when the slots were indexed
+    size_t mCount;
+    std::vector<qint64> mTree;   // kColumnCount values per node, 1-based
+    std::vector<qint64> mValues; // kColumnCount values per slot, as indexed
+};
+
+#endif /* TRAININGINDEX_H */
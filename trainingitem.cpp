@@ -0,0 +1,104 @@
+#include "trainingitem.h"
+
+#include <algorithm>
+
+TrainingItem blankDay() {
+    TrainingItem tmp;
+    tmp.weather = QString("Clear");
+    tmp.training = QString();
+    tmp.date = QDate::fromString("01/01/2050","dd/MM/yyyy");
+    tmp.hour = 0.0;
+    tmp.feeling = 0;
+    tmp.daily_objective = QString();
+    tmp.TSS = 0;
+    tmp.Km_per_day = 0;
+    tmp.hour_objective = 0;
+    tmp.TSS_objective = 0;
+    tmp.category = QString();
+    tmp.muscu = QString();
+    tmp.muscu_objective = QString();
+    tmp.km_per_week_objective = 0;
+    tmp.hour_per_week_objective = 0;
+    tmp.TSS_per_week_objective = 0;
+    return tmp;
+}
+
+TrainingWeek blankWeek() {
+    TrainingWeek tmp;
+    tmp.week_number = 0;
+    tmp.year = 0;
+    tmp.month = 0;
+    tmp.sum_hour = 0;
+    tmp.sum_tss = 0;
+    tmp.sum_km = 0;
+    tmp.sum_hour_objective = 0;
+    tmp.sum_tss_objective = 0;
+    tmp.sum_km_objective = 0;
+    tmp.category = 0;
+    return tmp;
+}
+
+void TrainingRecords::append(const TrainingItem &item)
+{
+    TrainingRecord record;
+    record.day = qint32(item.date.toJulianDay());
+    record.hour = float(item.hour);
+    record.TSS = float(item.TSS);
+    record.Km_per_day = float(item.Km_per_day);
+    record.hour_objective = float(item.hour_objective);
+    record.TSS_objective = float(item.TSS_objective);
+    record.km_per_week_objective = float(item.km_per_week_objective);
+    record.hour_per_week_objective = float(item.hour_per_week_objective);
+    record.TSS_per_week_objective = float(item.TSS_per_week_objective);
+    record.weather = strings.intern(item.weather);
+    record.training = strings.intern(item.training);
+    record.daily_objective = strings.intern(item.daily_objective);
+    record.category = strings.intern(item.category);
+    record.muscu = strings.intern(item.muscu);
+    record.muscu_objective = strings.intern(item.muscu_objective);
+    record.feeling = quint8(std::min<unsigned>(item.feeling, 255));
+    rows.push_back(record);
+}
+
+void TrainingRecords::append(const TrainingRecords &other)
+{
+    // Each distinct value is looked up once
+    std::vector<quint32> codes(other.strings.size(), StringPool::kNotFound);
+    auto code = [&](quint32 value) {
+        if (codes[value] == StringPool::kNotFound)
+            codes[value] = strings.intern(other.strings.text(value));
+        return codes[value];
+    };
+    for (TrainingRecord record: other.rows) {
+        record.weather = code(record.weather);
+        record.training = code(record.training);
+        record.daily_objective = code(record.daily_objective);
+        record.category = code(record.category);
+        record.muscu = code(record.muscu);
+        record.muscu_objective = code(record.muscu_objective);
+        rows.push_back(record);
+    }
+}
+
+TrainingItem TrainingRecords::item(size_t row) const
+{
+    const TrainingRecord &record = rows[row];
+    TrainingItem tmp;
+    tmp.weather = strings.text(record.weather);
+    tmp.date = QDate::fromJulianDay(record.day);
+    tmp.training = strings.text(record.training);
+    tmp.hour = record.hour;
+    tmp.feeling = record.feeling;
+    tmp.daily_objective = strings.text(record.daily_objective);
+    tmp.TSS = record.TSS;
+    tmp.Km_per_day = record.Km_per_day;
+    tmp.hour_objective = record.hour_objective;
+    tmp.TSS_objective = record.TSS_objective;
+    tmp.category = strings.text(record.category);
+    tmp.muscu = strings.text(record.muscu);
+    tmp.muscu_objective = strings.text(record.muscu_objective);
+    tmp.km_per_week_objective = record.km_per_week_objective;
+    tmp.hour_per_week_objective = record.hour_per_week_objective;
+    tmp.TSS_per_week_objective = record.TSS_per_week_objective;
+    return tmp;
+}
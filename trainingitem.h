@@ -0,0 +1,94 @@
+#ifndef TRAININGITEM_H
+#define TRAININGITEM_H
+
+#include <type_traits>
+#include <vector>
+
+#include <QtCore/QDate>
+#include <QtCore/QString>
+
+#include "stringpool.h"
+
+// Totals of a week (or month, season): 32 bytes, trivially copyable.
+// Sums are floats, enough for a few hundred thousand TSS at 0.01.
+class TrainingWeek {
+public:
+    qint16 year;
+    quint8 week_number;
+    quint8 month;
+    float sum_hour;
+    float sum_tss;
+    float sum_km;
+    float sum_hour_objective;
+    float sum_tss_objective;
+    float sum_km_objective;
+    quint32 category;       // code in the TrainingStore's strings(), 0 for none
+};
+
+static_assert(std::is_trivially_copyable<TrainingWeek>::value, "TrainingWeek is copied as plain memory");
+static_assert(sizeof(TrainingWeek) == 32, "TrainingWeek is half a cache line");
+
+class TrainingItem {
+public:
+    QString weather;
+    QDate date;
+    QString training;
+    double hour;
+    unsigned short int feeling;
+    QString daily_objective;
+    double TSS;
+    double Km_per_day;
+    double hour_objective;
+    double TSS_objective;
+    QString category;
+    QString muscu;
+    QString muscu_objective;
+    double km_per_week_objective;
+    double hour_per_week_objective;
+    double TSS_per_week_objective;
+};
+
+// Compact form of a TrainingItem used for bulk work (loading, merging,
+// sorting): one cache line, trivially copyable, so moving rows moves plain
+// memory. Metrics are floats, the training file keeps 6 significant digits
+// anyway. The texts are codes in the StringPool of the TrainingRecords
+// holding the record.
+class TrainingRecord {
+public:
+    qint32 day;             // Julian day
+    float hour;
+    float TSS;
+    float Km_per_day;
+    float hour_objective;
+    float TSS_objective;
+    float km_per_week_objective;
+    float hour_per_week_objective;
+    float TSS_per_week_objective;
+    quint32 weather;
+    quint32 training;
+    quint32 daily_objective;
+    quint32 category;
+    quint32 muscu;
+    quint32 muscu_objective;
+    quint8 feeling;
+};
+
+static_assert(std::is_trivially_copyable<TrainingRecord>::value, "TrainingRecord is copied as plain memory");
+static_assert(sizeof(TrainingRecord) == 64, "TrainingRecord is one cache line");
+
+// Records and the strings their codes refer to
+class TrainingRecords {
+public:
+    std::vector<TrainingRecord> rows;
+    StringPool strings;
+
+    void append(const TrainingItem &item);
+    // The rows of `other`, their codes translated to `strings`
+    void append(const TrainingRecords &other);
+    TrainingItem item(size_t row) const;
+};
+
+TrainingItem blankDay();
+TrainingWeek blankWeek();
+
+#endif /* TRAININGITEM_H */
@@ -0,0 +1,249 @@
+#include "trainingjournal.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtCore/QFileInfo>
+
+#include "log.h"
+#include "trace.h"
+
+namespace {
+
+// Journal records replayed at startup before the snapshot is rewritten
+const size_t kCompactionThreshold = 256;
+
+// Sort by day, the last record of a day wins. Records are trivially
+// copyable, sorting moves plain memory.
+void mergeDays(std::vector<TrainingRecord> &rows) {
+    std::stable_sort(rows.begin(), rows.end(), [](const TrainingRecord &a, const TrainingRecord &b) {
+        return a.day < b.day;
+    });
+    size_t kept = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (kept > 0 && rows[kept - 1].day == rows[i].day)
+            rows[kept - 1] = rows[i];
+        else
+            rows[kept++] = rows[i];
+    }
+    rows.resize(kept);
+}
+
+} // namespace
+
+TrainingJournal::TrainingJournal(const std::string &filename):
+    mFilename(filename),
+    mJournalName(QString::fromStdString(filename + ".journal")),
+    mOldJournalName(QString::fromStdString(filename + ".journal.old")),
+    mRecordCount(0)
+{
+    mJournal.setFileName(mJournalName);
+}
+
+TrainingJournal::~TrainingJournal()
+{
+    waitForCompaction();
+    mJournal.close();
+}
+
+TrainingRecords TrainingJournal::load(std::vector<TrainingFileError> *errors)
+{
+    TRACE_SCOPE("journal.load");
+    // No compaction may swap the files between the reads
+    QReadLocker lock(&mFilesLock);
+    TrainingRecords trainings;
+    loadTrainingsFromFile(mFilename, trainings, errors);
+    replayJournals(trainings, errors);
+    mergeDays(trainings.rows);
+    return trainings;
+}
+
+TrainingRecords TrainingJournal::query(const QDate &from, const QDate &to, const QString &category)
+{
+    TRACE_SCOPE("journal.query");
+    QReadLocker lock(&mFilesLock);
+    TrainingRecords trainings;
+    const std::vector<TrainingFileYear> years = trainingFileIndex(mFilename);
+    if (years.empty()) {
+        loadTrainingsFromFile(mFilename, trainings);
+    } else {
+        // The years of [from, to] follow each other in the snapshot
+        auto begin = std::lower_bound(years.begin(), years.end(), from.year(), [](const TrainingFileYear &year, int value) {
+            return year.year < value;
+        });
+        auto end = std::upper_bound(begin, years.end(), to.year(), [](int value, const TrainingFileYear &year) {
+            return value < year.year;
+        });
+        if (begin != end) {
+            TrainingFileRange range = begin->range;
+            range.size = (end - 1)->range.offset + (end - 1)->range.size - range.offset;
+            loadTrainingsFromFile(mFilename, range, trainings);
+        }
+    }
+    replayJournals(trainings, nullptr);
+    mergeDays(trainings.rows);
+
+    const qint64 first = from.toJulianDay();
+    const qint64 last = to.toJulianDay();
+    const quint32 code = category.isEmpty() ? 0 : trainings.strings.find(category);
+    auto outside = [&](const TrainingRecord &record) {
+        return record.day < first || record.day > last || (code != 0 && record.category != code);
+    };
+    if (code == StringPool::kNotFound)
+        trainings.rows.clear();
+    else
+        trainings.rows.erase(std::remove_if(trainings.rows.begin(), trainings.rows.end(), outside), trainings.rows.end());
+    return trainings;
+}
+
+int TrainingJournal::save(const TrainingItem &item)
+{
+    QMutexLocker lock(&mJournalMutex);
+    if (!mJournal.isOpen() && !openJournal())
+        return 1;
+    std::ostringstream record;
+    writeTrainingLine(record, item);
+    const std::string data = record.str();
+    if (mJournal.write(data.data(), data.size()) != qint64(data.size()) || !mJournal.flush()) {
+        LOG_ERROR("Cannot append to "<<mJournalName.toStdString());
+        return 1;
+    }
+    mRecordCount++;
+    return 0;
+}
+
+bool TrainingJournal::needsCompaction() const
+{
+    QMutexLocker lock(&mJournalMutex);
+    return mRecordCount >= kCompactionThreshold && !mCompaction.isRunning();
+}
+
+void TrainingJournal::compact()
+{
+    // Never wait for a load or a query: the next save tries again
+    if (!mFilesLock.tryLockForWrite())
+        return;
+    QMutexLocker lock(&mJournalMutex);
+    const bool rotated = !mCompaction.isRunning() && rotateJournal();
+    mFilesLock.unlock();
+    if (!rotated)
+        return;
+    mRecordCount = 0;
+
+    const std::string filename = mFilename;
+    const QString old_journal = mOldJournalName;
+    QReadWriteLock *files_lock = &mFilesLock;
+    mCompaction = QtConcurrent::run([filename, old_journal, files_lock]() {
+        TRACE_SCOPE("journal.compact");
+        // The edits made from now on go to the new journal
+        TrainingRecords records;
+        if (QFile::exists(QString::fromStdString(filename)))
+            loadTrainingsFromFile(filename, records);
+        loadTrainingsFromFile(old_journal.toStdString(), records);
+        mergeDays(records.rows);
+        std::vector<TrainingItem> trainings;
+        trainings.reserve(records.rows.size());
+        for (size_t row = 0; row < records.rows.size(); row++)
+            trainings.push_back(records.item(row));
+        // The snapshot, its year index and the old journal change together
+        QWriteLocker lock(files_lock);
+        int ret = saveTrainingsToFile(filename, trainings);
+        // Keep the old journal if the snapshot failed, it is replayed at next load
+        if (ret == 0)
+            QFile::remove(old_journal);
+        return ret;
+    });
+}
+
+void TrainingJournal::waitForCompaction()
+{
+    QFuture<int> compaction;
+    {
+        QMutexLocker lock(&mJournalMutex);
+        compaction = mCompaction;
+    }
+    compaction.waitForFinished();
+}
+
+std::vector<TrainingYearHash> TrainingJournal::yearHashes()
+{
+    TRACE_SCOPE("journal.year_hashes");
+    QReadLocker lock(&mFilesLock);
+    std::vector<TrainingYearHash> hashes;
+    const std::vector<TrainingFileYear> years = trainingFileIndex(mFilename);
+    if (years.empty() && QFileInfo(QString::fromStdString(mFilename)).size() > 0)
+        return hashes;
+
+    std::map<qint32, quint64> by_year;
+    for (const TrainingFileYear &year: years) {
+        const quint64 hash = trainingFileHash(mFilename, year.range);
+        if (hash == 0)
+            return hashes;
+        by_year[year.year] = hash;
+    }
+    // The journals are small, their records are hashed as written
+    QMutexLocker journal_lock(&mJournalMutex);
+    for (const QString &journal: {mOldJournalName, mJournalName}) {
+        if (!QFile::exists(journal))
+            continue;
+        TrainingRecords records;
+        loadTrainingsFromFile(journal.toStdString(), records);
+        for (size_t row = 0; row < records.rows.size(); row++) {
+            std::ostringstream record;
+            writeTrainingLine(record, records.item(row));
+            const std::string data = record.str();
+            quint64 &hash = by_year[QDate::fromJulianDay(records.rows[row].day).year()];
+            hash = contentHash(data.data(), data.size(), hash);
+        }
+    }
+    for (const auto &year: by_year)
+        hashes.push_back(TrainingYearHash{year.first, year.second});
+    return hashes;
+}
+
+void TrainingJournal::replayJournals(TrainingRecords &trainings, std::vector<TrainingFileError> *errors)
+{
+    // The old journal is only left behind by an unfinished compaction. No
+    // record is read half written.
+    QMutexLocker lock(&mJournalMutex);
+    mRecordCount = 0;
+    for (const QString &journal: {mOldJournalName, mJournalName}) {
+        if (!QFile::exists(journal))
+            continue;
+        const size_t before = trainings.rows.size();
+        loadTrainingsFromFile(journal.toStdString(), trainings, errors);
+        mRecordCount += trainings.rows.size() - before;
+    }
+}
+
+bool TrainingJournal::openJournal()
+{
+    if (!mJournal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        LOG_ERROR("Cannot open journal "<<mJournalName.toStdString());
+        return false;
+    }
+    return true;
+}
+
+bool TrainingJournal::rotateJournal()
+{
+    mJournal.close();
+    if (!QFile::exists(mJournalName))
+        return true;
+    if (!QFile::exists(mOldJournalName))
+        return QFile::rename(mJournalName, mOldJournalName);
+
+    // A previous compaction failed, its records go before the new ones
+    QFile old_journal(mOldJournalName);
+    QFile journal(mJournalName);
+    if (!old_journal.open(QIODevice::WriteOnly | QIODevice::Append) || !journal.open(QIODevice::ReadOnly)) {
+        LOG_ERROR("Cannot rotate journal "<<mJournalName.toStdString());
+        return false;
+    }
+    if (old_journal.write(journal.readAll()) < 0)
+        return false;
+    journal.close();
+    return journal.remove();
+}
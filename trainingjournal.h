@@ -0,0 +1,71 @@
+#ifndef TRAININGJOURNAL_H
+#define TRAININGJOURNAL_H
+
+#include <string>
+#include <vector>
+
+#include <QtCore/QFile>
+#include <QtCore/QFuture>
+#include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
+
+#include "trainingbackend.h"
+
+// Append-only persistence of the training file.
+//
+// "training.csv" is a snapshot, every edit is appended to
+// "training.csv.journal" as one record holding the whole day (the last record
+// of a day wins on replay). Once the journal grows past a few hundred records
+// it is rotated to "training.csv.journal.old" and the snapshot is rewritten in
+// the background, the old journal is removed when the new snapshot has been
+// renamed over the previous one.
+//
+// The snapshot is sorted by date, its year index lets query() read only the
+// years asked for and gives a cheap hash of each year. Loads, queries and
+// edits can come from different threads.
+class TrainingJournal: public TrainingBackend {
+public:
+    explicit TrainingJournal(const std::string &filename);
+    ~TrainingJournal() override;
+
+    // Snapshot + journal replay, ordered by date with one item per day
+    TrainingRecords load(std::vector<TrainingFileError> *errors = nullptr) override;
+    // The years of [from, to] in the snapshot + journal replay, the whole
+    // snapshot when it has no year index
+    TrainingRecords query(const QDate &from, const QDate &to, const QString &category = QString()) override;
+
+    // O(1) disk I/O: append one record to the journal
+    int save(const TrainingItem &item) override;
+
+    bool needsCompaction() const override;
+    // Rewrite the snapshot with the journal replayed, on a worker thread
+    void compact() override;
+    void waitForCompaction() override;
+
+    // The bytes of each year in the snapshot, then the journal records of the
+    // year in replay order; empty when the snapshot has no year index
+    std::vector<TrainingYearHash> yearHashes() override;
+
+    const std::string &filename() const override { return mFilename; }
+
+private:
+    // Append the records of the journals to `trainings`
+    void replayJournals(TrainingRecords &trainings, std::vector<TrainingFileError> *errors);
+    bool openJournal();
+    bool rotateJournal();
+
+    std::string mFilename;
+    QString mJournalName;
+    QString mOldJournalName;
+    QFile mJournal;
+    size_t mRecordCount;
+    QFuture<int> mCompaction;
+    // Held for reading while the snapshot and the journals are read, for
+    // writing while they are swapped: a rotation or a new snapshot
+    QReadWriteLock mFilesLock;
+    // Held while the journal is appended to or read, and for the members
+    // above; saves only wait for it
+    mutable QMutex mJournalMutex;
+};
+
+#endif /* TRAININGJOURNAL_H */
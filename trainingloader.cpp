@@ -0,0 +1,243 @@
+#include "trainingloader.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "derivedcache.h"
+#include "log.h"
+#include "trace.h"
+#include "trainingsummary.h"
+
+namespace {
+
+void loadSamples(DerivedSeries &derived, const QString &sample_directory)
+{
+    if (sample_directory.isEmpty())
+        return;
+    derived.samples = SampleStore(sample_directory);
+    derived.samples.scan();
+    derived.season_bests = loadSeasonBests(derived.samples);
+}
+
+// Julian day 0 is a monday
+qint64 mondayOf(qint64 day)
+{
+    return day - day % 7;
+}
+
+// First and last days of `year` holding a training
+void setYearDays(DerivedYear &year, const TrainingStore &trainings)
+{
+    const size_t begin = trainings.lowerBound(QDate(year.year, 1, 1));
+    const size_t end = trainings.lowerBound(QDate(year.year + 1, 1, 1));
+    year.first_day = begin < end ? trainings.dateAt(begin).toJulianDay() : 0;
+    year.last_day = begin < end ? trainings.dateAt(end - 1).toJulianDay() : -1;
+}
+
+// Replace the cached `years` by the ones of `hashes`, keeping what is known
+// of the unchanged ones. Returns the years to derive again, the removed ones
+// included.
+std::vector<qint32> matchYears(std::vector<DerivedYear> &years, const std::vector<TrainingYearHash> &hashes)
+{
+    std::vector<DerivedYear> matched;
+    std::vector<qint32> stale;
+    auto cached = years.begin();
+    for (const TrainingYearHash &hash: hashes) {
+        for (; cached != years.end() && cached->year < hash.year; ++cached)
+            stale.push_back(cached->year);
+        if (cached != years.end() && cached->year == hash.year && cached->hash == hash.hash) {
+            matched.push_back(*cached);
+        } else {
+            stale.push_back(hash.year);
+            matched.push_back(DerivedYear{hash.year, hash.hash, 0, -1});
+        }
+        if (cached != years.end() && cached->year == hash.year)
+            ++cached;
+    }
+    for (; cached != years.end(); ++cached)
+        stale.push_back(cached->year);
+    std::sort(stale.begin(), stale.end());
+    years = std::move(matched);
+    return stale;
+}
+
+// Derive the `stale` years again over the cached series. Each run of
+// consecutive years is read from the backend widened to whole weeks, so the
+// weeks across new year are summed complete.
+void deriveYears(TrainingBackend &backend, DerivedSeries &derived, std::vector<DerivedYear> &years, const std::vector<qint32> &stale)
+{
+    TRACE_SCOPE("derive_series.years");
+    TrainingRecords records;
+    std::vector<std::pair<qint64, qint64>> ranges;
+    for (size_t i = 0; i < stale.size();) {
+        size_t j = i + 1;
+        while (j < stale.size() && stale[j] == stale[j - 1] + 1)
+            j++;
+        const qint64 from = mondayOf(QDate(stale[i], 1, 1).toJulianDay());
+        const qint64 to = mondayOf(QDate(stale[j - 1], 12, 31).toJulianDay()) + 6;
+        records.append(backend.query(QDate::fromJulianDay(from), QDate::fromJulianDay(to)));
+        ranges.emplace_back(from, to);
+        i = j;
+    }
+    TrainingStore trainings;
+    trainings.assign(records);
+    TrainingIndex index;
+    index.build(trainings);
+
+    auto isStale = [&stale](qint32 year) {
+        return std::binary_search(stale.begin(), stale.end(), year);
+    };
+    qint64 first = 0;
+    qint64 last = -1;
+    for (DerivedYear &year: years) {
+        if (isStale(year.year))
+            setYearDays(year, trainings);
+        if (year.last_day < year.first_day)
+            continue;
+        first = last < first ? year.first_day : std::min(first, year.first_day);
+        last = std::max(last, year.last_day);
+    }
+
+    // TSS of the unchanged years from the cache, of the others from the backend
+    const size_t count = last >= first ? size_t(last - first + 1) : 0;
+    std::vector<double> tss(count, 0.0);
+    auto copy = [&](const double *values, qint64 values_first, size_t values_count, qint64 from, qint64 to) {
+        from = std::max(from, std::max(first, values_first));
+        to = std::min(to, std::min(last, values_first + qint64(values_count) - 1));
+        for (qint64 day = from; day <= to; day++)
+            tss[day - first] = values[day - values_first];
+    };
+    for (const DerivedYear &year: years) {
+        const qint64 from = QDate(year.year, 1, 1).toJulianDay();
+        const qint64 to = QDate(year.year, 12, 31).toJulianDay();
+        if (isStale(year.year)) {
+            const qint64 begin = std::max(from, first);
+            const qint64 end = std::min(to, last);
+            if (begin <= end)
+                trainings.copyColumn(TrainingStore::TSS, begin, size_t(end - begin + 1), &tss[begin - first]);
+        } else {
+            copy(derived.tss.data(), derived.first_day, derived.tss.size(), from, to);
+        }
+    }
+    const bool same_days = first == derived.first_day && count == derived.tss.size();
+    derived.tss = std::move(tss);
+    derived.first_day = first;
+    if (same_days) {
+        for (qint32 year: stale) {
+            const qint64 from = std::max(QDate(year, 1, 1).toJulianDay(), first);
+            const qint64 to = std::min(QDate(year, 12, 31).toJulianDay(), last);
+            if (from > to)
+                continue;
+            derived.fatigue.update(derived.tss.data(), count, first, from, to);
+            derived.fitness.update(derived.tss.data(), count, first, from, to);
+        }
+    } else {
+        derived.fatigue.compute(derived.tss.data(), count, first);
+        derived.fitness.compute(derived.tss.data(), count, first);
+    }
+
+    // The weeks starting in the ranges read are summed again
+    auto inRanges = [&ranges](const TrainingWeek &week) {
+        const qint64 monday = weekStart(week).toJulianDay();
+        for (const auto &range: ranges) {
+            if (monday >= range.first && monday <= range.second)
+                return true;
+        }
+        return false;
+    };
+    derived.weeks.erase(std::remove_if(derived.weeks.begin(), derived.weeks.end(), inRanges), derived.weeks.end());
+    for (TrainingWeek week: weekSummary(trainings, index)) {
+        if (!inRanges(week))
+            continue;
+        if (week.category != 0)
+            week.category = derived.strings.intern(trainings.strings().text(week.category));
+        derived.weeks.push_back(week);
+    }
+    std::sort(derived.weeks.begin(), derived.weeks.end(), [](const TrainingWeek &a, const TrainingWeek &b) {
+        return a.year != b.year ? a.year < b.year : a.week_number < b.week_number;
+    });
+}
+
+} // namespace
+
+DerivedSeries::DerivedSeries():
+    fatigue(fatigue_coef, std::size(fatigue_coef)),
+    fitness(fitness_coef, std::size(fitness_coef), fitness_coef_factor),
+    first_day(0)
+{
+}
+
+QSharedPointer<LoadedTrainings> loadTrainings(TrainingBackend &backend)
+{
+    TRACE_SCOPE("load_trainings");
+    QSharedPointer<LoadedTrainings> loaded(new LoadedTrainings);
+    loaded->trainings.assign(backend.load(&loaded->errors));
+    loaded->index.build(loaded->trainings);
+    return loaded;
+}
+
+QSharedPointer<LoadedTrainings> loadTrainings(TrainingBackend &backend, const QDate &from, const QDate &to)
+{
+    TRACE_SCOPE("load_trainings.window");
+    QSharedPointer<LoadedTrainings> loaded(new LoadedTrainings);
+    loaded->partitions.ensure(backend, loaded->trainings, from, to);
+    loaded->index.build(loaded->trainings);
+    return loaded;
+}
+
+QSharedPointer<DerivedSeries> deriveSeries(const TrainingStore &trainings, const TrainingIndex &index, const QString &sample_directory)
+{
+    TRACE_SCOPE("derive_series");
+    QSharedPointer<DerivedSeries> derived(new DerivedSeries);
+    derived->weeks = weekSummary(trainings, index);
+    // Every day from the first training to the last, the gaps between the
+    // years held at 0
+    const qint64 first = trainings.isEmpty() ? 0 : trainings.firstDate().toJulianDay();
+    const size_t count = trainings.isEmpty() ? 0 : size_t(trainings.lastDate().toJulianDay() - first + 1);
+    derived->tss.resize(count);
+    trainings.copyColumn(TrainingStore::TSS, first, count, derived->tss.data());
+    derived->fatigue.compute(derived->tss.data(), count, first);
+    derived->fitness.compute(derived->tss.data(), count, first);
+    derived->strings = trainings.strings();
+    derived->first_day = first;
+    loadSamples(*derived, sample_directory);
+    return derived;
+}
+
+QSharedPointer<DerivedSeries> deriveSeries(TrainingBackend &backend, const QString &sample_directory)
+{
+    // Hashed before reading: an edit in between is seen as a change next time
+    const std::vector<TrainingYearHash> hashes = backend.yearHashes();
+    QSharedPointer<DerivedSeries> derived(new DerivedSeries);
+    std::vector<DerivedYear> years;
+    std::vector<qint32> stale;
+    const bool cached = !hashes.empty() && readDerivedCache(backend.filename(), *derived, years);
+    if (cached)
+        stale = matchYears(years, hashes);
+
+    if (cached && stale.empty()) {
+        LOG_DEBUG("Derived series of "<<backend.filename()<<" read from the cache");
+    } else if (cached && stale.size() < years.size()) {
+        LOG_DEBUG("Deriving "<<stale.size()<<" of "<<years.size()<<" years of "<<backend.filename());
+        deriveYears(backend, *derived, years, stale);
+        writeDerivedCache(backend.filename(), *derived, years);
+    } else {
+        TrainingStore trainings;
+        std::vector<TrainingFileError> errors;
+        trainings.assign(backend.load(&errors));
+        TrainingIndex index;
+        index.build(trainings);
+        derived = deriveSeries(trainings, index);
+        derived->errors = std::move(errors);
+        if (!hashes.empty()) {
+            years.clear();
+            for (const TrainingYearHash &hash: hashes) {
+                years.push_back(DerivedYear{hash.year, hash.hash, 0, -1});
+                setYearDays(years.back(), trainings);
+            }
+            writeDerivedCache(backend.filename(), *derived, years);
+        }
+    }
+    loadSamples(*derived, sample_directory);
+    return derived;
+}
@@ -0,0 +1,58 @@
+#ifndef TRAININGLOADER_H
+#define TRAININGLOADER_H
+
+#include <vector>
+
+#include <QtCore/QSharedPointer>
+
+#include "loadmodel.h"
+#include "powercurve.h"
+#include "samplestore.h"
+#include "trainingfile.h"
+#include "trainingindex.h"
+#include "trainingbackend.h"
+#include "trainingpartitions.h"
+#include "trainingstore.h"
+
+// The startup work, split in two stages that can run on a worker thread: the
+// trainings first (enough for the current week), then the series derived from
+// the whole history. Results are shared pointers so that handing them over to
+// the GUI thread through a QFuture does not copy them.
+
+class LoadedTrainings {
+public:
+    TrainingStore trainings;
+    TrainingIndex index;
+    TrainingPartitions partitions;  // the years in `trainings` when it is a window
+    std::vector<TrainingFileError> errors;
+};
+
+class DerivedSeries {
+public:
+    DerivedSeries();
+
+    std::vector<TrainingWeek> weeks;
+    LoadSeries fatigue;
+    LoadSeries fitness;
+    SampleStore samples;
+    SeasonBests season_bests;
+    StringPool strings;             // the categories of `weeks`
+    std::vector<double> tss;        // TSS of each day, what fatigue and fitness are updated from
+    qint64 first_day;               // Julian day of tss[0]
+    std::vector<TrainingFileError> errors;
+};
+
+// Everything the backend holds
+QSharedPointer<LoadedTrainings> loadTrainings(TrainingBackend &backend);
+// Only the years of [from, to], the others are read later through `partitions`
+QSharedPointer<LoadedTrainings> loadTrainings(TrainingBackend &backend, const QDate &from, const QDate &to);
+// Week summary, fatigue and fitness of the whole history, and the season
+// bests of the sample files of `sample_directory` when there is one
+QSharedPointer<DerivedSeries> deriveSeries(const TrainingStore &trainings, const TrainingIndex &index, const QString &sample_directory = QString());
+// The same from the whole content of the backend, read for the occasion and
+// released once summed. When the backend hashes its years, the result is
+// kept in a cache next to its file and only the years changed since are
+// read and derived again.
+QSharedPointer<DerivedSeries> deriveSeries(TrainingBackend &backend, const QString &sample_directory = QString());
+
+#endif /* TRAININGLOADER_H */
@@ -0,0 +1,44 @@
+#include "trainingpartitions.h"
+
+#include <algorithm>
+
+#include "log.h"
+#include "trace.h"
+
+TrainingPartitions::TrainingPartitions(size_t capacity):
+    mCapacity(std::max(capacity, size_t(1)))
+{
+}
+
+bool TrainingPartitions::ensure(TrainingBackend &backend, TrainingStore &trainings, const QDate &from, const QDate &to)
+{
+    TRACE_SCOPE("partitions.ensure");
+    bool changed = false;
+    for (int year = from.year(); year <= to.year(); year++) {
+        auto it = std::find(mYears.begin(), mYears.end(), year);
+        if (it != mYears.end()) {
+            mYears.splice(mYears.begin(), mYears, it);
+            continue;
+        }
+        trainings.merge(backend.query(QDate(year, 1, 1), QDate(year, 12, 31)));
+        mYears.push_front(year);
+        changed = true;
+        LOG_DEBUG("Season "<<year<<" loaded");
+    }
+
+    // The days of an evicted year must not be waiting for a refresh
+    const size_t keep = std::max(mCapacity, size_t(to.year() - from.year() + 1));
+    while (mYears.size() > keep && !trainings.hasChanges()) {
+        const int year = mYears.back();
+        mYears.pop_back();
+        trainings.evict(QDate(year, 1, 1), QDate(year, 12, 31));
+        changed = true;
+        LOG_DEBUG("Season "<<year<<" evicted");
+    }
+    return changed;
+}
+
+bool TrainingPartitions::contains(int year) const
+{
+    return std::find(mYears.begin(), mYears.end(), year) != mYears.end();
+}
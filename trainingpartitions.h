@@ -0,0 +1,37 @@
+#ifndef TRAININGPARTITIONS_H
+#define TRAININGPARTITIONS_H
+
+#include <list>
+
+#include "trainingbackend.h"
+#include "trainingstore.h"
+
+// The years of a TrainingStore, read from the backend when a view needs them.
+//
+// The store only holds the years asked for lately: beyond `capacity`, the
+// least recently used ones are evicted, so that memory follows what is looked
+// at and not the length of the history. A year is read back by a range query
+// (the year index of the CSV snapshot, the primary key of the database).
+class TrainingPartitions {
+public:
+    static const size_t kDefaultCapacity = 3;
+
+    explicit TrainingPartitions(size_t capacity = kDefaultCapacity);
+
+    // Read the years of [from, to] missing from `trainings`, then evict the
+    // least recently used ones beyond the capacity, never those of [from, to]
+    // nor while the store has changes not taken yet. True when the store
+    // changed (its index and views need a reload).
+    bool ensure(TrainingBackend &backend, TrainingStore &trainings, const QDate &from, const QDate &to);
+
+    bool contains(int year) const;
+    // Most recently used first
+    const std::list<int> &years() const { return mYears; }
+    size_t capacity() const { return mCapacity; }
+
+private:
+    size_t mCapacity;
+    std::list<int> mYears;
+};
+
+#endif /* TRAININGPARTITIONS_H */
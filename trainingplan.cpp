@@ -0,0 +1,221 @@
+#include "trainingplan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#include <QtConcurrent/QtConcurrentMap>
+
+#include "loadmodel.h"
+#include "trace.h"
+
+namespace {
+
+const size_t kFatigueTaps = std::size(fatigue_coef);
+const size_t kFitnessTaps = std::size(fitness_coef);
+const size_t kTaps = std::max(kFatigueTaps, kFitnessTaps);
+
+// Share of the weekly load done each day, monday first
+const int kPatternCount = 3;
+const double kWeekPatterns[kPatternCount][7] = {
+    {0.00, 0.15, 0.15, 0.10, 0.15, 0.20, 0.25},   // rest on monday, long weekend
+    {0.00, 0.20, 0.15, 0.00, 0.20, 0.20, 0.25},   // rest on monday and thursday
+    {1/7.0, 1/7.0, 1/7.0, 1/7.0, 1/7.0, 1/7.0, 1/7.0},
+};
+
+// The search grid
+const int kPeakSteps = 24;          // fractions of the weekly limit
+const int kRampSteps = 6;           // fractions of the ramp limit
+const int kTaperDays[] = {0, 4, 7, 10, 14, 21};
+const int kTaperSteps = 7;          // 30 % to 90 % of the peak
+
+// Shapes scored together, their values of a day are contiguous
+const size_t kBlockSize = 256;
+// TSB from the target that still counts as on target
+const double kFormTolerance = 1.0;
+
+// What every shape of a search shares
+class SearchContext {
+public:
+    PlanGoal goal;
+    double base;            // weekly TSS of the four weeks before the start
+    double week_done;       // TSS done in the week of the start, before it
+    double fatigue_done;    // share of the days before the start in the race-day loads
+    double fitness_done;
+    double fitness_kernel[kFitnessTaps];
+};
+
+class Block {
+public:
+    size_t begin;
+    size_t end;
+};
+
+double tssBefore(const double *tss, size_t count, qint64 first_day, qint64 day) {
+    return day >= first_day && day < first_day + qint64(count) ? tss[day - first_day] : 0;
+}
+
+// Julian day 0 is a monday
+double dayTss(const PlanShape &shape, const SearchContext &context, qint64 day) {
+    const double level = day >= context.goal.race_day - shape.taper_days
+            ? shape.peak*shape.taper
+            : std::min<double>(shape.peak, context.base + shape.ramp*((day - context.goal.start)/7 + 1));
+    return level*kWeekPatterns[shape.pattern][day % 7];
+}
+
+std::vector<PlanShape> searchGrid(const PlanGoal &goal) {
+    std::vector<PlanShape> shapes;
+    for (qint16 pattern = 0; pattern < kPatternCount; pattern++) {
+        for (int peak = 1; peak <= kPeakSteps; peak++) {
+            for (int ramp = 1; ramp <= kRampSteps; ramp++) {
+                PlanShape shape{float(goal.max_week_tss*peak/kPeakSteps), float(goal.max_ramp*ramp/kRampSteps), 1.0f, 0, pattern};
+                for (int taper_days: kTaperDays) {
+                    shape.taper_days = qint16(taper_days);
+                    for (int taper = 0; taper < (taper_days > 0 ? kTaperSteps : 1); taper++) {
+                        shape.taper = taper_days > 0 ? 0.3f + 0.1f*taper : 1.0f;
+                        shapes.push_back(shape);
+                    }
+                }
+            }
+        }
+    }
+    return shapes;
+}
+
+// Race-day form and fitness of the shapes of `block`, 0 in `feasible` when a
+// calendar week goes over the limit
+void scoreBlock(const Block &block, const std::vector<PlanShape> &shapes, const SearchContext &context,
+                double *form, double *fitness, unsigned char *feasible) {
+    const size_t n = block.end - block.begin;
+    const PlanShape *shape = shapes.data() + block.begin;
+    std::vector<double> day_tss(n);
+    std::vector<double> week(n, context.week_done);
+    std::vector<double> fatigue(n, context.fatigue_done);
+    std::fill(fitness, fitness + n, context.fitness_done);
+    std::fill(feasible, feasible + n, 1);
+    const PlanGoal &goal = context.goal;
+    for (qint64 day = goal.start; day < goal.race_day; day++) {
+        for (size_t i = 0; i < n; i++)
+            day_tss[i] = dayTss(shape[i], context, day);
+        multiplyAdd(1.0, day_tss.data(), week.data(), n);
+        if (day % 7 == 6 || day + 1 == goal.race_day) {
+            for (size_t i = 0; i < n; i++) {
+                if (week[i] > goal.max_week_tss + 1e-6)
+                    feasible[i] = 0;
+            }
+            std::fill(week.begin(), week.end(), 0.0);
+        }
+        // Tap of this day in the loads of the race day
+        const size_t tap = size_t(goal.race_day - 1 - day);
+        if (tap < kFitnessTaps)
+            multiplyAdd(context.fitness_kernel[tap], day_tss.data(), fitness, n);
+        if (tap < kFatigueTaps)
+            multiplyAdd(fatigue_coef[tap], day_tss.data(), fatigue.data(), n);
+    }
+    for (size_t i = 0; i < n; i++)
+        form[i] = fitness[i] - fatigue[i];
+}
+
+} // namespace
+
+double PlanProjection::formAt(qint64 day) const
+{
+    if (day < first_day || day >= first_day + qint64(form.size()))
+        return 0;
+    return form[day - first_day];
+}
+
+PlanProjection projectPlan(const double *tss, size_t count, qint64 first_day, qint64 start, const std::vector<double> &plan)
+{
+    TRACE_SCOPE("plan.project");
+    // Only the last kTaps days done weigh on the planned ones
+    const qint64 from = start - qint64(kTaps);
+    std::vector<double> window(kTaps + plan.size());
+    for (size_t i = 0; i < kTaps; i++)
+        window[i] = tssBefore(tss, count, first_day, from + i);
+    std::copy(plan.begin(), plan.end(), window.begin() + kTaps);
+
+    LoadSeries fatigue(fatigue_coef, kFatigueTaps);
+    LoadSeries fitness(fitness_coef, kFitnessTaps, fitness_coef_factor);
+    fatigue.compute(window.data(), window.size(), from);
+    fitness.compute(window.data(), window.size(), from);
+
+    PlanProjection projection;
+    projection.first_day = start;
+    for (qint64 day = start; day <= start + qint64(plan.size()); day++) {
+        projection.fatigue.push_back(fatigue.at(day));
+        projection.fitness.push_back(fitness.at(day));
+        projection.form.push_back(projection.fitness.back() - projection.fatigue.back());
+    }
+    return projection;
+}
+
+std::vector<PlanCandidate> searchPlans(const double *tss, size_t count, qint64 first_day, const PlanGoal &goal, size_t results)
+{
+    TRACE_SCOPE("plan.search");
+    std::vector<PlanCandidate> candidates;
+    if (goal.race_day <= goal.start || goal.max_week_tss <= 0)
+        return candidates;
+
+    SearchContext context;
+    context.goal = goal;
+    context.base = 0;
+    for (qint64 day = goal.start - 28; day < goal.start; day++)
+        context.base += tssBefore(tss, count, first_day, day)/4;
+    context.week_done = 0;
+    for (qint64 day = goal.start - goal.start % 7; day < goal.start; day++)
+        context.week_done += tssBefore(tss, count, first_day, day);
+    for (size_t k = 0; k < kFitnessTaps; k++)
+        context.fitness_kernel[k] = fitness_coef[k]*fitness_coef_factor;
+    context.fatigue_done = 0;
+    context.fitness_done = 0;
+    for (size_t k = 0; k < kTaps; k++) {
+        const qint64 day = goal.race_day - 1 - qint64(k);
+        if (day >= goal.start)
+            continue;
+        const double value = tssBefore(tss, count, first_day, day);
+        if (k < kFatigueTaps)
+            context.fatigue_done += fatigue_coef[k]*value;
+        if (k < kFitnessTaps)
+            context.fitness_done += context.fitness_kernel[k]*value;
+    }
+
+    const std::vector<PlanShape> shapes = searchGrid(goal);
+    std::vector<double> form(shapes.size());
+    std::vector<double> fitness(shapes.size());
+    std::vector<unsigned char> feasible(shapes.size());
+    std::vector<Block> blocks;
+    for (size_t begin = 0; begin < shapes.size(); begin += kBlockSize)
+        blocks.push_back(Block{begin, std::min(begin + kBlockSize, shapes.size())});
+    QtConcurrent::blockingMap(blocks, [&](const Block &block) {
+        scoreBlock(block, shapes, context, form.data() + block.begin, fitness.data() + block.begin, feasible.data() + block.begin);
+    });
+
+    std::vector<size_t> order;
+    for (size_t i = 0; i < shapes.size(); i++) {
+        if (feasible[i])
+            order.push_back(i);
+    }
+    auto error = [&](size_t i) { return std::fabs(form[i] - goal.target_form); };
+    auto better = [&](size_t a, size_t b) {
+        const bool a_on = error(a) <= kFormTolerance;
+        const bool b_on = error(b) <= kFormTolerance;
+        if (a_on != b_on)
+            return a_on;
+        if (a_on && fitness[a] != fitness[b])
+            return fitness[a] > fitness[b];
+        return error(a) < error(b);
+    };
+    const size_t kept = std::min(results, order.size());
+    std::partial_sort(order.begin(), order.begin() + kept, order.end(), better);
+
+    for (size_t rank = 0; rank < kept; rank++) {
+        const size_t i = order[rank];
+        PlanCandidate candidate{shapes[i], form[i], fitness[i], std::vector<double>()};
+        candidate.tss.reserve(size_t(goal.race_day - goal.start));
+        for (qint64 day = goal.start; day < goal.race_day; day++)
+            candidate.tss.push_back(dayTss(shapes[i], context, day));
+        candidates.push_back(std::move(candidate));
+    }
+    return candidates;
+}
@@ -0,0 +1,67 @@
+#ifndef TRAININGPLAN_H
+#define TRAININGPLAN_H
+
+#include <vector>
+
+#include <QtCore/QtGlobal>
+
+// What-if projections of the load model over planned days, and a search of
+// the plans reaching a form on a race day.
+
+// Fatigue, fitness and form from `first_day` on
+class PlanProjection {
+public:
+    qint64 first_day = 0;
+    std::vector<double> fatigue;
+    std::vector<double> fitness;
+    std::vector<double> form;
+
+    size_t size() const { return form.size(); }
+    // 0 outside of the projection
+    double formAt(qint64 day) const;
+};
+
+// The load model over the TSS done before `start` (tss[0] is Julian day
+// `first_day`) followed by `plan`, the TSS planned from `start` on. The
+// projection covers the planned days and the day after them.
+PlanProjection projectPlan(const double *tss, size_t count, qint64 first_day, qint64 start, const std::vector<double> &plan);
+
+// What the plan search aims at
+class PlanGoal {
+public:
+    qint64 start;           // Julian day of the first planned day
+    qint64 race_day;        // Julian day of the race, after `start`
+    double target_form;     // TSB wanted on the race day
+    double max_week_tss;    // limit of each calendar week, the days done included
+    double max_ramp = 60;   // most TSS added to the weekly load from a week to the next
+};
+
+// A plan of the search. The weekly load climbs from the load of the last
+// four weeks by `ramp` a week up to `peak`, the `taper_days` before the race
+// are done at `taper` times the peak. Each week is spread over its days by
+// one of the weekly patterns (rest days, long weekend).
+class PlanShape {
+public:
+    float peak;         // weekly TSS
+    float ramp;
+    float taper;
+    qint16 taper_days;
+    qint16 pattern;
+};
+
+class PlanCandidate {
+public:
+    PlanShape shape;
+    double form;                // on the race day
+    double fitness;
+    std::vector<double> tss;    // planned TSS from goal.start to the day before the race
+};
+
+// Score every shape of the search grid (about 15000 of them) and return the
+// `results` best ones within the weekly limit: the ones ending within a TSB
+// of the target first, the fittest of them first, then the closest to the
+// target. The shapes are scored by blocks on the global thread pool, a block
+// being one multiply-add over all its shapes per planned day and kernel tap.
+std::vector<PlanCandidate> searchPlans(const double *tss, size_t count, qint64 first_day, const PlanGoal &goal, size_t results = 5);
+
+#endif /* TRAININGPLAN_H */
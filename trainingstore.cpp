@@ -0,0 +1,396 @@
+#include "trainingstore.h"
+
+#include <algorithm>
+#include <map>
+
+namespace {
+
+int yearOf(qint64 day)
+{
+    return QDate::fromJulianDay(day).year();
+}
+
+// The run holding `day`, or the first one after it
+std::vector<SlotLayout::Run>::const_iterator runAfter(const std::vector<SlotLayout::Run> &runs, qint64 day)
+{
+    return std::upper_bound(runs.begin(), runs.end(), day, [](qint64 day, const SlotLayout::Run &run) {
+        return day < run.first_day + qint64(run.count);
+    });
+}
+
+// First and last day of each year of `trainings`
+std::map<int, std::pair<qint64, qint64>> yearBounds(const TrainingRecords &trainings)
+{
+    std::map<int, std::pair<qint64, qint64>> years;
+    for (const TrainingRecord &record: trainings.rows) {
+        const auto it = years.emplace(yearOf(record.day), std::make_pair(record.day, record.day)).first;
+        it->second.first = std::min(it->second.first, qint64(record.day));
+        it->second.second = std::max(it->second.second, qint64(record.day));
+    }
+    return years;
+}
+
+} // namespace
+
+size_t SlotLayout::slotOf(qint64 day) const
+{
+    const auto run = runAfter(runs, day);
+    if (run == runs.end() || day < run->first_day)
+        return kNoSlot;
+    return run->slot + (day - run->first_day);
+}
+
+size_t SlotLayout::lowerSlot(qint64 day) const
+{
+    const auto run = runAfter(runs, day);
+    if (run == runs.end())
+        return size();
+    return run->slot + std::max(day - run->first_day, qint64(0));
+}
+
+qint64 SlotLayout::dayOf(size_t slot) const
+{
+    const auto run = std::upper_bound(runs.begin(), runs.end(), slot, [](size_t slot, const Run &run) {
+        return slot < run.slot + run.count;
+    });
+    return run->first_day + qint64(slot - run->slot);
+}
+
+TrainingStore::TrainingStore():
+    mReset(false)
+{
+}
+
+void TrainingStore::assign(const TrainingRecords &trainings)
+{
+    for (std::vector<double> &column: mColumns)
+        column.clear();
+    mFeeling.clear();
+    mText.clear();
+    mTexts.clear();
+    mStrings.clear();
+    mRows.clear();
+    mLayout.runs.clear();
+    mChanged.clear();
+    mReset = true;
+
+    for (const auto &year: yearBounds(trainings)) {
+        extendTo(year.second.first);
+        extendTo(year.second.second);
+    }
+    mTexts.reserve(trainings.rows.size());
+    mRows.reserve(trainings.rows.size());
+    std::vector<quint32> codes(trainings.strings.size(), StringPool::kNotFound);
+    for (const TrainingRecord &record: trainings.rows)
+        store(record, trainings.strings, codes);
+    for (const SlotLayout::Run &run: mLayout.runs) {
+        for (size_t i = 0; i < run.count; i++) {
+            if (mText[run.slot + i] >= 0)
+                mRows.push_back(run.first_day + i);
+        }
+    }
+}
+
+void TrainingStore::assign(const std::vector<TrainingItem> &trainings)
+{
+    TrainingRecords records;
+    records.rows.reserve(trainings.size());
+    for (const TrainingItem &item: trainings) {
+        if (item.date.isValid())
+            records.append(item);
+    }
+    assign(records);
+}
+
+std::vector<TrainingItem> TrainingStore::toVector() const
+{
+    std::vector<TrainingItem> trainings;
+    trainings.reserve(mRows.size());
+    for (qint32 day: mRows)
+        trainings.push_back(item(day));
+    return trainings;
+}
+
+size_t TrainingStore::lowerBound(const QDate &date) const
+{
+    return std::lower_bound(mRows.begin(), mRows.end(), date.toJulianDay()) - mRows.begin();
+}
+
+bool TrainingStore::contains(const QDate &date) const
+{
+    return containsDay(date.toJulianDay());
+}
+
+TrainingItem TrainingStore::value(const QDate &date) const
+{
+    if (containsDay(date.toJulianDay()))
+        return item(date.toJulianDay());
+    TrainingItem tmp = blankDay();
+    tmp.date = date;
+    return tmp;
+}
+
+void TrainingStore::insert(const TrainingItem &item)
+{
+    const qint64 day = item.date.toJulianDay();
+    extendTo(day);
+    // Appending after the last day is the common case
+    if (store(item))
+        mRows.insert(std::upper_bound(mRows.begin(), mRows.end(), day), day);
+    if (!mReset)
+        mChanged.push_back(day);
+}
+
+void TrainingStore::merge(const TrainingRecords &trainings)
+{
+    if (trainings.rows.empty())
+        return;
+    for (const auto &year: yearBounds(trainings)) {
+        extendTo(year.second.first);
+        extendTo(year.second.second);
+    }
+
+    std::vector<quint32> codes(trainings.strings.size(), StringPool::kNotFound);
+    std::vector<qint32> added;
+    for (const TrainingRecord &record: trainings.rows) {
+        if (!containsDay(record.day) && store(record, trainings.strings, codes))
+            added.push_back(record.day);
+    }
+    std::sort(added.begin(), added.end());
+    const size_t middle = mRows.size();
+    mRows.insert(mRows.end(), added.begin(), added.end());
+    std::inplace_merge(mRows.begin(), mRows.begin() + middle, mRows.end());
+}
+
+void TrainingStore::evict(const QDate &from, const QDate &to)
+{
+    const auto begin = std::lower_bound(mRows.begin(), mRows.end(), from.toJulianDay());
+    const auto end = std::upper_bound(begin, mRows.end(), to.toJulianDay());
+    if (begin == end)
+        return;
+    for (auto day = begin; day != end; ++day) {
+        const size_t slot = mLayout.slotOf(*day);
+        for (std::vector<double> &column: mColumns)
+            column[slot] = 0.0;
+        mFeeling[slot] = 0;
+        mText[slot] = -1;
+    }
+    mRows.erase(begin, end);
+
+    // Each year left only spans the days between its first and last training
+    SlotLayout layout;
+    qint64 year_end = 0;
+    for (qint32 day: mRows) {
+        if (layout.runs.empty() || day > year_end) {
+            layout.runs.push_back(SlotLayout::Run{day, layout.size(), 1});
+            year_end = QDate(yearOf(day), 12, 31).toJulianDay();
+        } else {
+            layout.runs.back().count = day - layout.runs.back().first_day + 1;
+        }
+    }
+    std::vector<double> columns[ColumnCount];
+    for (std::vector<double> &column: columns)
+        column.resize(layout.size());
+    std::vector<unsigned short> feeling(layout.size());
+    std::vector<qint32> text(layout.size());
+    for (const SlotLayout::Run &run: layout.runs) {
+        // The old run of that year holds the new one
+        const size_t slot = mLayout.slotOf(run.first_day);
+        for (int column = 0; column < ColumnCount; column++)
+            std::copy_n(mColumns[column].begin() + slot, run.count, columns[column].begin() + run.slot);
+        std::copy_n(mFeeling.begin() + slot, run.count, feeling.begin() + run.slot);
+        std::copy_n(mText.begin() + slot, run.count, text.begin() + run.slot);
+    }
+    for (int column = 0; column < ColumnCount; column++)
+        mColumns[column].swap(columns[column]);
+    mFeeling.swap(feeling);
+    mText.swap(text);
+    mLayout = std::move(layout);
+
+    // And the text table the days that hold a training
+    std::vector<TrainingText> texts;
+    texts.reserve(mRows.size());
+    for (qint32 day: mRows) {
+        qint32 &text = mText[mLayout.slotOf(day)];
+        texts.push_back(std::move(mTexts[text]));
+        text = qint32(texts.size() - 1);
+    }
+    mTexts.swap(texts);
+}
+
+TrainingChanges TrainingStore::takeChanges()
+{
+    TrainingChanges changes;
+    changes.reset = mReset;
+    if (!mReset) {
+        std::sort(mChanged.begin(), mChanged.end());
+        mChanged.erase(std::unique(mChanged.begin(), mChanged.end()), mChanged.end());
+        changes.days.swap(mChanged);
+    }
+    mChanged.clear();
+    mReset = false;
+    return changes;
+}
+
+TrainingStore::TrainingText &TrainingStore::textAt(size_t slot, bool &added)
+{
+    added = mText[slot] < 0;
+    if (added) {
+        mText[slot] = mTexts.size();
+        mTexts.emplace_back();
+    }
+    return mTexts[mText[slot]];
+}
+
+bool TrainingStore::store(const TrainingItem &item)
+{
+    const size_t slot = mLayout.slotOf(item.date.toJulianDay());
+    bool added;
+    TrainingText &text = textAt(slot, added);
+
+    mColumns[TSS][slot] = item.TSS;
+    mColumns[Hour][slot] = item.hour;
+    mColumns[Km][slot] = item.Km_per_day;
+    mColumns[TSSObjective][slot] = item.TSS_objective;
+    mColumns[HourObjective][slot] = item.hour_objective;
+    mColumns[KmObjective][slot] = item.km_per_week_objective;
+    mColumns[TSSWeekObjective][slot] = item.TSS_per_week_objective;
+    mColumns[HourWeekObjective][slot] = item.hour_per_week_objective;
+    mFeeling[slot] = item.feeling;
+
+    text.weather = mStrings.intern(item.weather);
+    text.training = item.training;
+    text.daily_objective = mStrings.intern(item.daily_objective);
+    text.category = mStrings.intern(item.category);
+    text.muscu = item.muscu;
+    text.muscu_objective = mStrings.intern(item.muscu_objective);
+    return added;
+}
+
+bool TrainingStore::store(const TrainingRecord &record, const StringPool &strings, std::vector<quint32> &codes)
+{
+    const size_t slot = mLayout.slotOf(record.day);
+    bool added;
+    TrainingText &text = textAt(slot, added);
+
+    mColumns[TSS][slot] = record.TSS;
+    mColumns[Hour][slot] = record.hour;
+    mColumns[Km][slot] = record.Km_per_day;
+    mColumns[TSSObjective][slot] = record.TSS_objective;
+    mColumns[HourObjective][slot] = record.hour_objective;
+    mColumns[KmObjective][slot] = record.km_per_week_objective;
+    mColumns[TSSWeekObjective][slot] = record.TSS_per_week_objective;
+    mColumns[HourWeekObjective][slot] = record.hour_per_week_objective;
+    mFeeling[slot] = record.feeling;
+
+    // Each distinct value is looked up once
+    auto code = [&](quint32 value) {
+        if (codes[value] == StringPool::kNotFound)
+            codes[value] = mStrings.intern(strings.text(value));
+        return codes[value];
+    };
+    text.weather = code(record.weather);
+    text.training = strings.text(record.training);
+    text.daily_objective = code(record.daily_objective);
+    text.category = code(record.category);
+    text.muscu = strings.text(record.muscu);
+    text.muscu_objective = code(record.muscu_objective);
+    return added;
+}
+
+double TrainingStore::dayValue(Column column, qint64 day) const
+{
+    const size_t slot = mLayout.slotOf(day);
+    return slot == SlotLayout::kNoSlot ? 0.0 : mColumns[column][slot];
+}
+
+void TrainingStore::copyColumn(Column column, qint64 from, size_t count, double *out) const
+{
+    std::fill(out, out + count, 0.0);
+    const double *values = mColumns[column].data();
+    const qint64 to = from + qint64(count);
+    for (const SlotLayout::Run &run: mLayout.runs) {
+        const qint64 first = std::max(from, run.first_day);
+        const qint64 last = std::min(to, run.first_day + qint64(run.count));
+        if (first < last)
+            std::copy(values + run.slot + (first - run.first_day), values + run.slot + (last - run.first_day), out + (first - from));
+    }
+}
+
+QDate TrainingStore::firstDate() const
+{
+    return mRows.empty() ? QDate() : QDate::fromJulianDay(mRows.front());
+}
+
+QDate TrainingStore::lastDate() const
+{
+    return mRows.empty() ? QDate() : QDate::fromJulianDay(mRows.back());
+}
+
+TrainingItem TrainingStore::item(qint32 day) const
+{
+    const size_t slot = mLayout.slotOf(day);
+    const TrainingText &text = mTexts[mText[slot]];
+    TrainingItem tmp;
+    tmp.weather = mStrings.text(text.weather);
+    tmp.date = QDate::fromJulianDay(day);
+    tmp.training = text.training;
+    tmp.hour = mColumns[Hour][slot];
+    tmp.feeling = mFeeling[slot];
+    tmp.daily_objective = mStrings.text(text.daily_objective);
+    tmp.TSS = mColumns[TSS][slot];
+    tmp.Km_per_day = mColumns[Km][slot];
+    tmp.hour_objective = mColumns[HourObjective][slot];
+    tmp.TSS_objective = mColumns[TSSObjective][slot];
+    tmp.category = mStrings.text(text.category);
+    tmp.muscu = text.muscu;
+    tmp.muscu_objective = mStrings.text(text.muscu_objective);
+    tmp.km_per_week_objective = mColumns[KmObjective][slot];
+    tmp.hour_per_week_objective = mColumns[HourWeekObjective][slot];
+    tmp.TSS_per_week_objective = mColumns[TSSWeekObjective][slot];
+    return tmp;
+}
+
+bool TrainingStore::containsDay(qint64 day) const
+{
+    const size_t slot = mLayout.slotOf(day);
+    return slot != SlotLayout::kNoSlot && mText[slot] >= 0;
+}
+
+void TrainingStore::extendTo(qint64 day)
+{
+    std::vector<SlotLayout::Run> &runs = mLayout.runs;
+    auto run = runs.begin() + (runAfter(runs, day) - runs.begin());
+    if (run != runs.end() && day >= run->first_day)
+        return;
+    const int year = yearOf(day);
+    size_t count;
+    if (run != runs.begin() && yearOf(std::prev(run)->first_day) == year) {
+        // After the last day held of that year
+        --run;
+        count = day - (run->first_day + qint64(run->count)) + 1;
+        insertSlots(run->slot + run->count, count);
+    } else if (run != runs.end() && yearOf(run->first_day) == year) {
+        // Before the first one
+        count = run->first_day - day;
+        insertSlots(run->slot, count);
+        run->first_day = day;
+    } else {
+        // A year not held yet
+        const size_t slot = run == runs.end() ? mText.size() : run->slot;
+        run = runs.insert(run, SlotLayout::Run{day, slot, 0});
+        count = 1;
+        insertSlots(slot, count);
+    }
+    run->count += count;
+    for (auto next = std::next(run); next != runs.end(); ++next)
+        next->slot += count;
+}
+
+void TrainingStore::insertSlots(size_t slot, size_t count)
+{
+    for (std::vector<double> &column: mColumns)
+        column.insert(column.begin() + slot, count, 0.0);
+    mFeeling.insert(mFeeling.begin() + slot, count, 0);
+    mText.insert(mText.begin() + slot, count, -1);
+}
@@ -0,0 +1,183 @@
+#ifndef TRAININGSTORE_H
+#define TRAININGSTORE_H
+
+#include <iterator>
+#include <vector>
+
+#include "stringpool.h"
+#include "trainingitem.h"
+
+// Days modified in a TrainingStore since the changes were last taken
+class TrainingChanges {
+public:
+    bool reset;                // the whole content was replaced
+    std::vector<qint32> days;  // Julian days, ascending, empty on reset
+
+    bool isEmpty() const { return !reset && days.empty(); }
+};
+
+// Where the days of a TrainingStore live in its dense columns.
+//
+// Each calendar year held is a run of consecutive days, from its first to its
+// last training, and the runs follow each other in date order in the slots.
+// A year away from the others costs no slot for the gap.
+class SlotLayout {
+public:
+    class Run {
+    public:
+        qint64 first_day;  // Julian day of the first slot
+        size_t slot;
+        size_t count;
+
+        bool operator==(const Run &other) const { return first_day == other.first_day && slot == other.slot && count == other.count; }
+    };
+
+    static const size_t kNoSlot = size_t(-1);
+
+    size_t size() const { return runs.empty() ? 0 : runs.back().slot + runs.back().count; }
+    // Slot of Julian day `day`, kNoSlot when no run holds it
+    size_t slotOf(qint64 day) const;
+    // First slot of a day on or after `day`, size() if there is none
+    size_t lowerSlot(qint64 day) const;
+    qint64 dayOf(size_t slot) const;
+
+    std::vector<Run> runs;             // ascending, at most one per year
+};
+
+// Trainings indexed by Julian day, stored by columns.
+//
+// The numbers live in dense columns (0 on the days without training) so the
+// aggregations and the load model read contiguous doubles. There is one slot
+// per day of each year held, between its first and its last training, see
+// SlotLayout. The text fields are kept aside, in a table only reached from
+// the days holding a training; the repetitive ones (weather, category,
+// objectives) are interned in strings() and stored as codes.
+// A day is found in O(log years) and the days holding a training are listed in
+// date order in mRows, so iterating the store is always ordered. Adding a day
+// after the last one (the usual case) is O(1) amortized.
+class TrainingStore {
+public:
+    enum Column {
+        TSS,
+        Hour,
+        Km,
+        TSSObjective,
+        HourObjective,
+        KmObjective,
+        TSSWeekObjective,
+        HourWeekObjective,
+        ColumnCount
+    };
+
+    class const_iterator {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef TrainingItem value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const TrainingItem *pointer;
+        typedef TrainingItem reference;
+
+        const_iterator(const TrainingStore *store, size_t row):
+            mStore(store), mRow(row) {}
+        TrainingItem operator*() const { return mStore->at(mRow); }
+        const_iterator &operator++() { ++mRow; return *this; }
+        const_iterator operator++(int) { const_iterator tmp = *this; ++mRow; return tmp; }
+        bool operator==(const const_iterator &other) const { return mRow == other.mRow; }
+        bool operator!=(const const_iterator &other) const { return mRow != other.mRow; }
+    private:
+        const TrainingStore *mStore;
+        size_t mRow;
+    };
+
+    TrainingStore();
+
+    // Replace the content, when a day appears twice the last item wins
+    void assign(const TrainingRecords &trainings);
+    void assign(const std::vector<TrainingItem> &trainings);
+    std::vector<TrainingItem> toVector() const;
+
+    size_t size() const { return mRows.size(); }
+    bool isEmpty() const { return mRows.empty(); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, mRows.size()); }
+
+    // Row order is date order
+    TrainingItem at(size_t row) const { return item(mRows[row]); }
+    QDate dateAt(size_t row) const { return QDate::fromJulianDay(mRows[row]); }
+    // First row on or after `date`, size() if there is none
+    size_t lowerBound(const QDate &date) const;
+
+    bool contains(const QDate &date) const;
+    // The training of that day, or a blank day at that date
+    TrainingItem value(const QDate &date) const;
+    // Add or replace the training of item.date
+    void insert(const TrainingItem &item);
+
+    // Partitions read back from the backend and dropped again, they are not
+    // edits and record no change. merge() keeps the days already held,
+    // evict() should wait until the changes of its days are taken.
+    void merge(const TrainingRecords &trainings);
+    void evict(const QDate &from, const QDate &to);
+
+    // What changed since the last call: each view refreshes only those days
+    bool hasChanges() const { return mReset || !mChanged.empty(); }
+    TrainingChanges takeChanges();
+
+    QDate firstDate() const;
+    QDate lastDate() const;
+
+    // Dense columns: `slotCount()` values, laid out by layout()
+    const SlotLayout &layout() const { return mLayout; }
+    size_t slotCount() const { return mText.size(); }
+    size_t slotOf(qint64 day) const { return mLayout.slotOf(day); }
+    const double *column(Column column) const { return mColumns[column].data(); }
+    // The value of Julian day `day`, 0 when the store does not hold that day
+    double dayValue(Column column, qint64 day) const;
+    // The values of `count` days from Julian day `from`, 0 on the days not held
+    void copyColumn(Column column, qint64 from, size_t count, double *out) const;
+    const unsigned short *feeling() const { return mFeeling.data(); }
+    bool hasTraining(size_t slot) const { return mText[slot] >= 0; }
+    const QString &category(size_t slot) const { return mStrings.text(mTexts[mText[slot]].category); }
+    // Codes in strings(), equal codes are equal texts
+    quint32 categoryCode(size_t slot) const { return mTexts[mText[slot]].category; }
+    quint32 weatherCode(size_t slot) const { return mTexts[mText[slot]].weather; }
+    const StringPool &strings() const { return mStrings; }
+    // Code of `text` in strings(), added if needed, for the data kept along
+    // the store (the categories of the week summaries)
+    quint32 intern(const QString &text) { return mStrings.intern(text); }
+
+private:
+    class TrainingText {
+    public:
+        QString training;
+        QString muscu;
+        quint32 weather = 0;           // codes in mStrings
+        quint32 daily_objective = 0;
+        quint32 category = 0;
+        quint32 muscu_objective = 0;
+    };
+
+    TrainingItem item(qint32 day) const;
+    bool containsDay(qint64 day) const;
+    // Fill the slot of item.date, true when the day had no training yet
+    bool store(const TrainingItem &item);
+    // Same for a record, `codes` maps the codes of `strings` to mStrings
+    bool store(const TrainingRecord &record, const StringPool &strings, std::vector<quint32> &codes);
+    // The text of the day at `slot`, added if needed (then `added` is true)
+    TrainingText &textAt(size_t slot, bool &added);
+    // Make room for `day` in the run of its year
+    void extendTo(qint64 day);
+    void insertSlots(size_t slot, size_t count);
+
+    SlotLayout mLayout;
+    std::vector<double> mColumns[ColumnCount];
+    std::vector<unsigned short> mFeeling;
+    std::vector<qint32> mText;         // index in mTexts, -1 when there is no training that day
+    std::vector<TrainingText> mTexts;
+    StringPool mStrings;
+    std::vector<qint32> mRows;         // Julian days holding a training, ascending
+    std::vector<qint32> mChanged;      // days inserted since takeChanges(), unsorted
+    bool mReset;                       // assign() since takeChanges()
+};
+
+#endif /* TRAININGSTORE_H */
@@ -0,0 +1,107 @@
+#include "trainingsummary.h"
+
+#include <algorithm>
+
+#include "trace.h"
+
+namespace {
+
+void setWeekNumber(TrainingWeek &week, const QDate &monday)
+{
+    int year;
+    week.week_number = quint8(monday.weekNumber(&year));
+    week.year = qint16(year);
+}
+
+// The week starting on Julian day `monday`, false when nothing was done
+bool weekAt(const TrainingStore &trainings, const TrainingIndex &index, qint64 monday, TrainingWeek &week)
+{
+    const QDate first = QDate::fromJulianDay(monday);
+    week = rangeSummary(index, first, first.addDays(6));
+    if (week.sum_hour == 0 && week.sum_km == 0 && week.sum_tss == 0)
+        return false;
+
+    setWeekNumber(week, first);
+    const SlotLayout &layout = trainings.layout();
+    const size_t end = layout.lowerSlot(monday + 7);
+    for (size_t slot = layout.lowerSlot(monday); slot < end; slot++) {
+        if (!trainings.hasTraining(slot))
+            continue;
+        if (week.month == 0)
+            week.month = QDate::fromJulianDay(layout.dayOf(slot)).month();
+        if (trainings.categoryCode(slot) != 0)
+            week.category = trainings.categoryCode(slot);
+    }
+    return true;
+}
+
+bool weekBefore(const TrainingWeek &week, const TrainingWeek &other)
+{
+    if (week.year != other.year)
+        return week.year < other.year;
+    return week.week_number < other.week_number;
+}
+
+} // namespace
+
+TrainingWeek rangeSummary(const TrainingIndex &index, const QDate &from, const QDate &to)
+{
+    double sums[TrainingIndex::kColumnCount];
+    index.sums(from, to, sums);
+    TrainingWeek week = blankWeek();
+    week.sum_tss = sums[TrainingStore::TSS];
+    week.sum_hour = sums[TrainingStore::Hour];
+    week.sum_km = sums[TrainingStore::Km];
+    week.sum_tss_objective = sums[TrainingStore::TSSObjective];
+    week.sum_hour_objective = sums[TrainingStore::HourObjective];
+    week.sum_km_objective = sums[TrainingStore::KmObjective];
+    return week;
+}
+
+QDate weekStart(const TrainingWeek &week)
+{
+    // January 4th is always in week 1
+    const QDate january4(week.year, 1, 4);
+    return january4.addDays(1 - january4.dayOfWeek() + 7*(week.week_number - 1));
+}
+
+std::vector<TrainingWeek> weekSummary(const TrainingStore &trainings, const TrainingIndex &index)
+{
+    TRACE_SCOPE("week_summary");
+    std::vector<TrainingWeek> weeks;
+    if (trainings.isEmpty())
+        return weeks;
+
+    TrainingWeek week;
+    qint64 next = 0;
+    for (const SlotLayout::Run &run: trainings.layout().runs) {
+        // Julian day 0 is a monday, the week of a new year may be done already
+        const qint64 end = run.first_day + qint64(run.count);
+        qint64 monday = std::max(run.first_day - run.first_day % 7, next);
+        for (; monday < end; monday += 7) {
+            if (weekAt(trainings, index, monday, week))
+                weeks.push_back(week);
+        }
+        next = monday;
+    }
+    return weeks;
+}
+
+void updateWeekSummary(std::vector<TrainingWeek> &weeks, const TrainingStore &trainings, const TrainingIndex &index, const QDate &date)
+{
+    TRACE_SCOPE("week_summary.update");
+    const qint64 day = date.toJulianDay();
+    TrainingWeek week;
+    const bool done = weekAt(trainings, index, day - day % 7, week);
+    if (!done)
+        setWeekNumber(week, date.addDays(1 - date.dayOfWeek()));
+
+    auto it = std::lower_bound(weeks.begin(), weeks.end(), week, weekBefore);
+    const bool found = it != weeks.end() && !weekBefore(week, *it);
+    if (done && found)
+        *it = week;
+    else if (done)
+        weeks.insert(it, week);
+    else if (found)
+        weeks.erase(it);
+}
@@ -0,0 +1,20 @@
+#ifndef TRAININGSUMMARY_H
+#define TRAININGSUMMARY_H
+
+#include <vector>
+
+#include "trainingindex.h"
+#include "trainingstore.h"
+
+// Totals from `from` to `to` included, week, year and month are left to 0
+TrainingWeek rangeSummary(const TrainingIndex &index, const QDate &from, const QDate &to);
+
+// Monday of an ISO week
+QDate weekStart(const TrainingWeek &week);
+
+// One TrainingWeek per ISO week with some km, hours or TSS done, in date order
+std::vector<TrainingWeek> weekSummary(const TrainingStore &trainings, const TrainingIndex &index);
+// Refresh the week of `date` in `weeks` after an edit of that day
+void updateWeekSummary(std::vector<TrainingWeek> &weeks, const TrainingStore &trainings, const TrainingIndex &index, const QDate &date);
+
+#endif /* TRAININGSUMMARY_H */
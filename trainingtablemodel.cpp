@@ -0,0 +1,148 @@
+#include "trainingtablemodel.h"
+
+#include <QtGui/QColor>
+
+#include "trace.h"
+
+namespace {
+
+QColor computeColor(double done, double todo) {
+    int red = 255*(1-done/todo);
+    int green = 255*done/todo;
+    red = (red<0)?0: red;
+    red = (red>255)?255: red;
+    green = (green<0)?0: green;
+    green = (green>255)?255: green;
+    return QColor(red, green, 0, 127);
+}
+
+} // namespace
+
+TrainingTableModel::TrainingTableModel(const TrainingStore &trainings, QObject *parent):
+    QAbstractTableModel(parent),
+    mTrainings(trainings),
+    mFirstRow(0),
+    mRowCount(0),
+    mCachedRow(-1)
+{
+    mHeader<<"Date"<<"Weather"<<"Description"<<"Target"<<"TSS"<<"TSS obj."<<"Km"<<"Km obj."<<"Feeling"<<"Duration"<<"Duration obj."<<"Musculation"<<"Muscu Target";
+    updateRows(mFirstRow, mRowCount);
+}
+
+void TrainingTableModel::setDateRange(const QDate &from, const QDate &to)
+{
+    if (from == mFrom && to == mTo)
+        return;
+    mFrom = from;
+    mTo = to;
+    reload();
+}
+
+void TrainingTableModel::reload()
+{
+    TRACE_SCOPE("table.reload");
+    beginResetModel();
+    mCachedRow = -1;
+    updateRows(mFirstRow, mRowCount);
+    endResetModel();
+}
+
+bool TrainingTableModel::dayChanged(const QDate &date)
+{
+    // A day added before the range shifts its rows in the store
+    mCachedRow = -1;
+    size_t first_row;
+    int row_count;
+    updateRows(first_row, row_count);
+    if (mFrom.isValid() && (date < mFrom || date > mTo)) {
+        mFirstRow = first_row;
+        return false;
+    }
+    const int row = mTrainings.lowerBound(date) - first_row;
+    if (row_count == mRowCount + 1) {
+        beginInsertRows(QModelIndex(), row, row);
+        mFirstRow = first_row;
+        mRowCount = row_count;
+        endInsertRows();
+    } else if (row_count != mRowCount) {
+        // Several days of one refresh added at once
+        beginResetModel();
+        mFirstRow = first_row;
+        mRowCount = row_count;
+        endResetModel();
+    } else {
+        mFirstRow = first_row;
+        emit dataChanged(index(row, 0), index(row, columnCount() - 1));
+    }
+    return true;
+}
+
+int TrainingTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : mRowCount;
+}
+
+int TrainingTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : mHeader.size();
+}
+
+QVariant TrainingTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mRowCount)
+        return QVariant();
+
+    const TrainingItem &it = item(index.row());
+    if (role == Qt::DisplayRole) {
+        switch (index.column()) {
+        case 0: return it.date.toString();
+        case 1: return it.weather;
+        case 2: return it.training;
+        case 3: return it.daily_objective;
+        case 4: return it.TSS;
+        case 5: return it.TSS_objective;
+        case 6: return it.Km_per_day;
+        case 7: return it.km_per_week_objective;
+        case 8: return it.feeling;
+        case 9: return it.hour;
+        case 10: return it.hour_objective;
+        case 11: return it.muscu;
+        case 12: return it.muscu_objective;
+        }
+    } else if (role == Qt::BackgroundRole) {
+        switch (index.column()) {
+        case 4: return computeColor(it.TSS, it.TSS_objective);
+        case 6: return computeColor(it.Km_per_day, it.km_per_week_objective);
+        case 8: return computeColor(it.feeling, 6);
+        case 9: return computeColor(it.hour, it.hour_objective);
+        }
+    }
+    return QVariant();
+}
+
+QVariant TrainingTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal || section >= mHeader.size())
+        return QVariant();
+    return mHeader.at(section);
+}
+
+void TrainingTableModel::updateRows(size_t &first_row, int &row_count) const
+{
+    if (!mFrom.isValid()) {
+        first_row = 0;
+        row_count = mTrainings.size();
+        return;
+    }
+    first_row = mTrainings.lowerBound(mFrom);
+    row_count = mTrainings.lowerBound(mTo.addDays(1)) - first_row;
+}
+
+const TrainingItem &TrainingTableModel::item(int row) const
+{
+    if (row != mCachedRow) {
+        mCachedItem = mTrainings.at(mFirstRow + row);
+        mCachedRow = row;
+    }
+    return mCachedItem;
+}
@@ -0,0 +1,47 @@
+#ifndef TRAININGTABLEMODEL_H
+#define TRAININGTABLEMODEL_H
+
+#include <QtCore/QAbstractTableModel>
+#include <QtCore/QDate>
+#include <QtCore/QStringList>
+
+#include "trainingstore.h"
+
+// Table of the trainings between two dates, read straight from the store.
+//
+// Nothing is built ahead: the view asks for the cells of the visible rows only
+// and an edit of one day signals that single row.
+class TrainingTableModel: public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit TrainingTableModel(const TrainingStore &trainings, QObject *parent = nullptr);
+
+    // Restrict the table to [from, to], the whole history when both are invalid
+    void setDateRange(const QDate &from, const QDate &to);
+    // The whole store changed
+    void reload();
+    // The training of `date` was added or modified, false when it is not shown
+    bool dayChanged(const QDate &date);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    void updateRows(size_t &first_row, int &row_count) const;
+    const TrainingItem &item(int row) const;
+
+    const TrainingStore &mTrainings;
+    QStringList mHeader;
+    QDate mFrom;
+    QDate mTo;
+    size_t mFirstRow;
+    int mRowCount;
+    // The view reads a row cell by cell, keep the last row decoded
+    mutable int mCachedRow;
+    mutable TrainingItem mCachedItem;
+};
+
+#endif /* TRAININGTABLEMODEL_H */